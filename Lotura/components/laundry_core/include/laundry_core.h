@@ -1,10 +1,36 @@
 #ifndef LAUNDRY_CORE_H
 #define LAUNDRY_CORE_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
+/**
+ * @brief 채널 하나의 최근 측정값과 상태.
+ */
+typedef struct {
+	float amps;		  ///< 전류 RMS
+	uint32_t lHour;	  ///< 유량 (L/h)
+	int drain;		  ///< 배수 센서 값
+	bool dryer;		  ///< 모드 스위치가 건조기 쪽
+	bool running;	  ///< 사이클 진행 중
+	int64_t cycle_ms; ///< 진행 중인 사이클의 경과 시간, 아니면 0
+} laundry_channel_status_t;
+
+/**
+ * @brief 코어 루프 한 번의 결과.
+ */
+typedef struct {
+	uint32_t seq;  ///< 공개할 때마다 1씩 증가
+	int64_t at_ms; ///< 측정 시각 (부팅 후 ms)
+	laundry_channel_status_t ch[2];
+} laundry_status_t;
+
 /**
  * @brief 세탁/건조 로직을 수행하는 메인 태스크.
+ * @details 시작할 때 리셋 전에 진행 중이던 사이클을 RTC 메모리(없으면
+ * NVS)에서 되살린다. 다운 시간이 종료 지연보다 짧고 모드 스위치가 그대로면
+ * "RESUME" 로그를 보내고 이어가며, 아니면 "reason"(리셋 원인)과
+ * "cause"(state_lost, mode_changed, end_delay)를 담은 "END" 로그로 닫는다.
  * @param pvParameters 태스크 파라미터 (사용 안함)
  */
 void laundry_core_task(void *pvParameters);
@@ -14,6 +40,14 @@ void laundry_core_task(void *pvParameters);
  * @return JSON 문자열 (호출자가 free해야 함)
  */
 char *laundry_core_get_status_json(void);
+
+/**
+ * @brief 코어 루프가 마지막으로 공개한 측정값과 상태를 복사한다.
+ * @details 루프가 반복마다 끝에서 공개한 사본을 잠금 없이 읽으므로 센서를
+ * 다시 읽지 않고 루프를 기다리게 하지도 않는다. 태스크가 시작하기 전에는
+ * seq가 0이다.
+ */
+void laundry_core_get_status(laundry_status_t *out);
 uint32_t laundry_core_get_lHour(int channel);
 
 #endif
\ No newline at end of file
@@ -1,15 +1,23 @@
 #include "laundry_core.h"
 #include "cJSON.h"
+#include "esp_attr.h"
 #include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "esp_rtc_time.h"
+#include "esp_system.h"
 #include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "gpio_definitions.h"
+#include "osj_boot.h"
 #include "osj_gpio.h"
 #include "osj_nvs.h"
 #include "osj_sensor.h"
+#include "osj_snapshot.h"
+#include "osj_time.h"
 #include "osj_websocket.h"
 #include <math.h>
+#include <stddef.h>
 #include <string.h>
 #include "osj_config.h"
 
@@ -21,6 +29,9 @@ static int ch1FlowW = 50, ch2FlowW = 50;
 static float ch1CurrD = 0.5, ch2CurrD = 0.5;
 static int ch1EndDelayW = 100000, ch2EndDelayW = 100000;
 static int ch1EndDelayD = 10000, ch2EndDelayD = 10000;
+static float hysteresisMargin = 0.05f;
+// Config generation the values above were copied from.
+static uint32_t cfg_gen = 0;
 
 static int ch1CurrStatus = 1;
 static int ch2CurrStatus = 1;
@@ -53,6 +64,49 @@ static int64_t sePrevMillis1 = 0, sePrevMillis2 = 0;
 static uint32_t lastFlow1 = 0, lastFlow2 = 0;
 static int64_t lastFlowCalcTime = 0;
 
+// In-progress cycles survive resets. Every transition is copied into RTC
+// slow memory, which is plain RAM that keeps its contents over soft resets,
+// panics and watchdogs. START and END are also handed to a low-priority
+// task that stores them in NVS for resets that clear RTC memory, such as a
+// power cut. The core loop itself never writes flash.
+#define CYCLE_MAGIC 0x3259434c // "LCY2"
+#define CYCLE_KEY "cycleState"
+#define CYCLE_HEARTBEAT_MS 1000
+
+typedef struct {
+	uint8_t active;
+	uint8_t dryer;
+	uint8_t flag_c;
+	uint8_t flag_f;
+	uint8_t flag_w;
+	int32_t log_cnt;
+	int64_t age_ms;		  // cycle age when saved
+	int64_t quiet_ms;	  // how long the end delay had been running
+	int64_t start_utc_ms; // 0 if the time was unknown
+} cycle_ckpt_t;
+
+typedef struct {
+	uint32_t magic;
+	int64_t rtc_us; // esp_rtc_get_time_us() when saved
+	cycle_ckpt_t ch[2];
+	uint32_t crc;
+} cycle_record_t;
+
+static RTC_NOINIT_ATTR cycle_record_t rtc_cycle;
+static cycle_record_t nvs_cycle;
+static portMUX_TYPE cycle_mux = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t cycle_saver = NULL;
+static cycle_ckpt_t saved_ckpt[2];
+static int64_t cycle_saved_at = 0;
+
+// What the loop measured and decided last, for readers outside the task.
+static laundry_status_t status_slots[2];
+static osj_snapshot_t status_snap = {
+	.slot = {&status_slots[0], &status_slots[1]},
+	.size = sizeof(laundry_status_t),
+};
+static uint32_t status_seq = 0;
+
 static int64_t millis() { return esp_timer_get_time() / 1000; }
 
 static void send_log_entry(int channel, const char *type, int state,
@@ -64,6 +118,7 @@ static void send_log_entry(int channel, const char *type, int state,
 
 	cJSON *entry = cJSON_CreateObject();
 	cJSON_AddNumberToObject(entry, "t", millis() - start_time);
+	osj_time_add_stamp(entry);
 	cJSON_AddStringToObject(entry, "n", type);
 	cJSON_AddNumberToObject(entry, "s", state);
 
@@ -77,25 +132,27 @@ static void send_log_entry(int channel, const char *type, int state,
 	cJSON_Delete(log_obj);
 }
 
-static void send_start_log(int channel) {
-	cJSON *log_obj = cJSON_CreateObject();
-	cJSON *entry = cJSON_CreateObject();
-	cJSON_AddStringToObject(entry, "local_time", "");
-	cJSON_AddItemToObject(log_obj, "START", entry);
-
-	char *json_str = cJSON_PrintUnformatted(log_obj);
-	if (json_str) {
-		osj_websocket_send_log(channel, json_str);
-		free(json_str);
-	}
-	cJSON_Delete(log_obj);
-}
-
-static void send_end_log(int channel) {
+// START, END and RESUME entries. reason, down_ms (>= 0) and start_utc_ms
+// (> 0) are only given for entries written while restoring a cycle after a
+// reset; the start time lets the server match them to the cycle's START.
+static void send_marker_log(int channel, const char *name, const char *reason,
+							const char *cause, int64_t down_ms,
+							int64_t start_utc_ms) {
 	cJSON *log_obj = cJSON_CreateObject();
 	cJSON *entry = cJSON_CreateObject();
-	cJSON_AddStringToObject(entry, "local_time", "");
-	cJSON_AddItemToObject(log_obj, "END", entry);
+	char local_time[32];
+	osj_time_format_iso(osj_time_now_ms(), local_time, sizeof(local_time));
+	cJSON_AddStringToObject(entry, "local_time", local_time);
+	osj_time_add_stamp(entry);
+	if (reason)
+		cJSON_AddStringToObject(entry, "reason", reason);
+	if (cause)
+		cJSON_AddStringToObject(entry, "cause", cause);
+	if (down_ms >= 0)
+		cJSON_AddNumberToObject(entry, "down_ms", down_ms);
+	if (start_utc_ms > 0)
+		cJSON_AddNumberToObject(entry, "start_ts", (double)start_utc_ms);
+	cJSON_AddItemToObject(log_obj, name, entry);
 
 	char *json_str = cJSON_PrintUnformatted(log_obj);
 	if (json_str) {
@@ -117,7 +174,7 @@ static void DryerStatusJudgment(float amps, int *cnt, int *m,
 	int ledPin = (ch == 1) ? PIN_CH1_LED : PIN_CH2_LED;
 
 
-	if (amps < (currD - sys_config.hysteresisMargin) && *logFlag) {
+	if (amps < (currD - hysteresisMargin) && *logFlag) {
 		if (*logFlagC == 1) {
 			*logFlagC = 0;
 			send_log_entry(ch, "C", 0, *logMillis);
@@ -126,7 +183,7 @@ static void DryerStatusJudgment(float amps, int *cnt, int *m,
 	}
 
 
-	if (amps > (currD + sys_config.hysteresisMargin)) {
+	if (amps > (currD + hysteresisMargin)) {
 		if (*logFlag) {
 			if (*logFlagC == 0) {
 				*logFlagC = 1;
@@ -138,7 +195,7 @@ static void DryerStatusJudgment(float amps, int *cnt, int *m,
 			*logFlag = true;
 			*logCnt = 1;
 			*logMillis = millis();
-			send_start_log(ch);
+			send_marker_log(ch, "START", NULL, NULL, -1, 0);
 			*cnt = 0;
 			FAST_GPIO_SET(ledPin);
 			*currStatus = 0;
@@ -157,7 +214,7 @@ static void DryerStatusJudgment(float amps, int *cnt, int *m,
 		} else if ((millis() - *prevMillisEnd) >= endDelay) {
 			*logFlagC = 0;
 			*logFlag = false;
-			send_end_log(ch);
+			send_marker_log(ch, "END", NULL, NULL, -1, 0);
 			ESP_LOGI(TAG, "CH%d Dryer Ended", ch);
 			osj_websocket_send_status(ch, 1, "DRY");
 			*cnt = 1;
@@ -187,19 +244,19 @@ static void StatusJudgment(float amps, int water, uint32_t flow, int *cnt,
 	int ledPin = (ch == 1) ? PIN_CH1_LED : PIN_CH2_LED;
 
 
-	if ((amps > (currW + sys_config.hysteresisMargin) || water || flow > flowW) && *seCnt == 0) {
+	if ((amps > (currW + hysteresisMargin) || water || flow > flowW) && *seCnt == 0) {
 		*seCnt = 1;
 		*sePrev = millis();
-	} else if ((amps < (currW - sys_config.hysteresisMargin) && !water && flow < flowW) && *seCnt == 1) {
+	} else if ((amps < (currW - hysteresisMargin) && !water && flow < flowW) && *seCnt == 1) {
 		*seCnt = 0;
 	}
 
 	if (*logFlag) {
-		if (amps > (currW + sys_config.hysteresisMargin) && *logFlagC == 0) {
+		if (amps > (currW + hysteresisMargin) && *logFlagC == 0) {
 			*logFlagC = 1;
 			send_log_entry(ch, "C", 1, *logMillis);
 			(*logCnt)++;
-		} else if (amps < (currW - sys_config.hysteresisMargin) && *logFlagC == 1) {
+		} else if (amps < (currW - hysteresisMargin) && *logFlagC == 1) {
 			*logFlagC = 0;
 			send_log_entry(ch, "C", 0, *logMillis);
 			(*logCnt)++;
@@ -229,7 +286,7 @@ static void StatusJudgment(float amps, int water, uint32_t flow, int *cnt,
 			*logFlag = true;
 			*logCnt = 1;
 			*logMillis = millis();
-			send_start_log(ch);
+			send_marker_log(ch, "START", NULL, NULL, -1, 0);
 			*seCnt = 0;
 			*cnt = 0;
 			FAST_GPIO_SET(ledPin);
@@ -251,7 +308,7 @@ static void StatusJudgment(float amps, int water, uint32_t flow, int *cnt,
 			*logFlagF = 0;
 			*logFlagW = 0;
 			*logFlag = false;
-			send_end_log(ch);
+			send_marker_log(ch, "END", NULL, NULL, -1, 0);
 			ESP_LOGI(TAG, "CH%d Washer Ended", ch);
 			osj_websocket_send_status(ch, 1, "WASH");
 			*cnt = 1;
@@ -261,23 +318,250 @@ static void StatusJudgment(float amps, int water, uint32_t flow, int *cnt,
 	}
 }
 
+static uint32_t cycle_crc(const cycle_record_t *rec) {
+	return esp_rom_crc32_le(0, (const uint8_t *)rec,
+							offsetof(cycle_record_t, crc));
+}
+
+static bool cycle_valid(const cycle_record_t *rec) {
+	return rec->magic == CYCLE_MAGIC && rec->crc == cycle_crc(rec);
+}
+
+static void cycle_capture(int ch, bool dryer, cycle_ckpt_t *c) {
+	int64_t start = (ch == 1) ? jsonLogMillis1 : jsonLogMillis2;
+	int64_t quiet_since = (ch == 1) ? previousMillisEnd1 : previousMillisEnd2;
+	memset(c, 0, sizeof(*c));
+	c->active = ((ch == 1) ? ch1Cnt : ch2Cnt) == 0;
+	if (!c->active)
+		return;
+	c->dryer = dryer;
+	c->flag_c = (ch == 1) ? jsonLogFlag1C : jsonLogFlag2C;
+	c->flag_f = (ch == 1) ? jsonLogFlag1F : jsonLogFlag2F;
+	c->flag_w = (ch == 1) ? jsonLogFlag1W : jsonLogFlag2W;
+	c->log_cnt = (ch == 1) ? jsonLogCnt1 : jsonLogCnt2;
+	c->age_ms = millis() - start;
+	if (((ch == 1) ? m1 : m2) == 0)
+		c->quiet_ms = millis() - quiet_since;
+	c->start_utc_ms = osj_time_utc_ms(start * 1000);
+}
+
+// Age, quiet time and start time move on their own and ride along with the
+// heartbeat; only these make a checkpoint due.
+static bool cycle_same(const cycle_ckpt_t *a, const cycle_ckpt_t *b) {
+	return a->active == b->active && a->dryer == b->dryer &&
+		   a->flag_c == b->flag_c && a->flag_f == b->flag_f &&
+		   a->flag_w == b->flag_w && a->log_cnt == b->log_cnt;
+}
+
+static void cycle_save(const cycle_ckpt_t ckpt[2], bool durable) {
+	rtc_cycle.magic = 0;
+	rtc_cycle.rtc_us = (int64_t)esp_rtc_get_time_us();
+	rtc_cycle.ch[0] = ckpt[0];
+	rtc_cycle.ch[1] = ckpt[1];
+	rtc_cycle.magic = CYCLE_MAGIC;
+	rtc_cycle.crc = cycle_crc(&rtc_cycle);
+
+	saved_ckpt[0] = ckpt[0];
+	saved_ckpt[1] = ckpt[1];
+	cycle_saved_at = millis();
+
+	if (durable && cycle_saver) {
+		portENTER_CRITICAL(&cycle_mux);
+		nvs_cycle = rtc_cycle;
+		portEXIT_CRITICAL(&cycle_mux);
+		xTaskNotifyGive(cycle_saver);
+	}
+}
+
+// Called once per loop. Costs a few compares unless something changed, and
+// a RAM write plus CRC once a second while a cycle runs, so the RTC copy
+// also tells how long the board was down.
+static void cycle_checkpoint(void) {
+	cycle_ckpt_t now[2];
+	cycle_capture(1, !isCh1Mode, &now[0]);
+	cycle_capture(2, !isCh2Mode, &now[1]);
+
+	bool changed = !cycle_same(&now[0], &saved_ckpt[0]) ||
+				   !cycle_same(&now[1], &saved_ckpt[1]);
+	bool durable = now[0].active != saved_ckpt[0].active ||
+				   now[1].active != saved_ckpt[1].active;
+	bool running = now[0].active || now[1].active;
+	if (changed ||
+		(running && millis() - cycle_saved_at >= CYCLE_HEARTBEAT_MS))
+		cycle_save(now, durable);
+}
+
+static void cycle_saver_task(void *arg) {
+	cycle_record_t rec;
+	for (;;) {
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		portENTER_CRITICAL(&cycle_mux);
+		rec = nvs_cycle;
+		portEXIT_CRITICAL(&cycle_mux);
+		esp_err_t err = osj_nvs_set_blob(CYCLE_KEY, &rec, sizeof(rec));
+		if (err != ESP_OK)
+			ESP_LOGW(TAG, "Cycle state not stored: %s", esp_err_to_name(err));
+	}
+}
+
+static const char *reset_reason_name(esp_reset_reason_t reason) {
+	switch (reason) {
+	case ESP_RST_POWERON:
+		return "power_on";
+	case ESP_RST_BROWNOUT:
+		return "brownout";
+	case ESP_RST_SW:
+		return "restart";
+	case ESP_RST_PANIC:
+		return "panic";
+	case ESP_RST_INT_WDT:
+	case ESP_RST_TASK_WDT:
+	case ESP_RST_WDT:
+		return "watchdog";
+	default:
+		return "other";
+	}
+}
+
+static void cycle_resume(int ch, const cycle_ckpt_t *c, int64_t down_ms,
+						 const char *reason) {
+	int64_t now = millis();
+	if (ch == 1) {
+		ch1Cnt = 0;
+		m1 = 0;
+		previousMillisEnd1 = now - c->quiet_ms - down_ms;
+		jsonLogFlag1 = true;
+		jsonLogFlag1C = c->flag_c;
+		jsonLogFlag1F = c->flag_f;
+		jsonLogFlag1W = c->flag_w;
+		jsonLogCnt1 = c->log_cnt;
+		jsonLogMillis1 = now - c->age_ms - down_ms;
+		ch1CurrStatus = 0;
+		FAST_GPIO_SET(PIN_CH1_LED);
+	} else {
+		ch2Cnt = 0;
+		m2 = 0;
+		previousMillisEnd2 = now - c->quiet_ms - down_ms;
+		jsonLogFlag2 = true;
+		jsonLogFlag2C = c->flag_c;
+		jsonLogFlag2F = c->flag_f;
+		jsonLogFlag2W = c->flag_w;
+		jsonLogCnt2 = c->log_cnt;
+		jsonLogMillis2 = now - c->age_ms - down_ms;
+		ch2CurrStatus = 0;
+		FAST_GPIO_SET(PIN_CH2_LED);
+	}
+	send_marker_log(ch, "RESUME", reason, NULL, down_ms, c->start_utc_ms);
+	osj_websocket_send_status(ch, 0, c->dryer ? "DRY" : "WASH");
+	ESP_LOGI(TAG, "CH%d cycle resumed after %s (%lld ms down)", ch, reason,
+			 down_ms);
+}
+
+// A cycle is picked up again only when the RTC copy says how long the board
+// was down, the quiet time before the reset plus that gap is shorter than
+// the end delay, and the mode switch was not moved. Otherwise the server gets the END it would have missed.
+static void cycle_restore(void) {
+	cycle_record_t rec = rtc_cycle;
+	int64_t rtc_now = (int64_t)esp_rtc_get_time_us();
+	int64_t down_ms = -1;
+
+	// The RTC counter restarts on power-on, so an older-looking record is
+	// left over from before it.
+	if (cycle_valid(&rec) && rtc_now >= rec.rtc_us) {
+		down_ms = (rtc_now - rec.rtc_us) / 1000;
+	} else {
+		size_t len = sizeof(rec);
+		if (osj_nvs_get_blob(CYCLE_KEY, &rec, &len) != ESP_OK ||
+			len != sizeof(rec) || !cycle_valid(&rec))
+			return;
+	}
+
+	const char *reason = reset_reason_name(esp_reset_reason());
+	bool touched = false;
+	for (int ch = 1; ch <= 2; ch++) {
+		const cycle_ckpt_t *c = &rec.ch[ch - 1];
+		if (!c->active)
+			continue;
+		touched = true;
+
+		bool dryer = !((ch == 1) ? isCh1Mode : isCh2Mode);
+		int endDelay = dryer ? ((ch == 1) ? ch1EndDelayD : ch2EndDelayD)
+							 : ((ch == 1) ? ch1EndDelayW : ch2EndDelayW);
+		const char *cause = NULL;
+		if (down_ms < 0)
+			cause = "state_lost";
+		else if (dryer != c->dryer)
+			cause = "mode_changed";
+		else if (c->quiet_ms + down_ms >= endDelay)
+			cause = "end_delay";
+
+		if (!cause) {
+			cycle_resume(ch, c, down_ms, reason);
+			continue;
+		}
+		send_marker_log(ch, "END", reason, cause, down_ms, c->start_utc_ms);
+		osj_websocket_send_status(ch, 1, c->dryer ? "DRY" : "WASH");
+		ESP_LOGW(TAG, "CH%d cycle closed after %s (%s)", ch, reason, cause);
+	}
+
+	cycle_ckpt_t now[2];
+	cycle_capture(1, !isCh1Mode, &now[0]);
+	cycle_capture(2, !isCh2Mode, &now[1]);
+	cycle_save(now, touched);
+}
+
+static void status_publish(void) {
+	laundry_status_t st;
+	int64_t now = millis();
+	st.seq = ++status_seq;
+	st.at_ms = now;
+	for (int ch = 1; ch <= 2; ch++) {
+		laundry_channel_status_t *c = &st.ch[ch - 1];
+		c->amps = (ch == 1) ? ampsTrms1 : ampsTrms2;
+		c->lHour = (ch == 1) ? lHour1 : lHour2;
+		c->drain = (ch == 1) ? waterSensorData1 : waterSensorData2;
+		c->dryer = !((ch == 1) ? isCh1Mode : isCh2Mode);
+		c->running = ((ch == 1) ? ch1Cnt : ch2Cnt) == 0;
+		c->cycle_ms =
+			c->running ? now - ((ch == 1) ? jsonLogMillis1 : jsonLogMillis2)
+					   : 0;
+	}
+	osj_snapshot_publish(&status_snap, &st);
+}
+
+static void config_refresh(void) {
+	uint32_t gen = osj_config_generation();
+	if (gen == cfg_gen)
+		return;
+	const SystemConfig *cfg = osj_config_acquire();
+	ch1CurrW = cfg->ch1CurrW;
+	ch2CurrW = cfg->ch2CurrW;
+	ch1FlowW = cfg->ch1FlowW;
+	ch2FlowW = cfg->ch2FlowW;
+	ch1CurrD = cfg->ch1CurrD;
+	ch2CurrD = cfg->ch2CurrD;
+	ch1EndDelayW = cfg->ch1EndDelayW;
+	ch2EndDelayW = cfg->ch2EndDelayW;
+	ch1EndDelayD = cfg->ch1EndDelayD;
+	ch2EndDelayD = cfg->ch2EndDelayD;
+	hysteresisMargin = cfg->hysteresisMargin;
+	osj_config_release(cfg);
+	cfg_gen = gen;
+}
+
 void laundry_core_task(void *pvParameters) {
 	ESP_LOGI(TAG, "Laundry Core Task Started");
+	bool detect_marked = false;
+
+	xTaskCreate(cycle_saver_task, "cycle_saver", 3072, NULL, 2, &cycle_saver);
+	config_refresh();
+	isCh1Mode = !FAST_GPIO_READ(PIN_CH1_MODE);
+	isCh2Mode = !FAST_GPIO_READ(PIN_CH2_MODE);
+	cycle_restore();
 
 	while (1) {
 
-        osj_config_lock();
-        ch1CurrW = sys_config.ch1CurrW;
-        ch2CurrW = sys_config.ch2CurrW;
-        ch1FlowW = sys_config.ch1FlowW;
-        ch2FlowW = sys_config.ch2FlowW;
-        ch1CurrD = sys_config.ch1CurrD;
-        ch2CurrD = sys_config.ch2CurrD;
-        ch1EndDelayW = sys_config.ch1EndDelayW;
-        ch2EndDelayW = sys_config.ch2EndDelayW;
-        ch1EndDelayD = sys_config.ch1EndDelayD;
-        ch2EndDelayD = sys_config.ch2EndDelayD;
-        osj_config_unlock();
+		config_refresh();
 
 		ampsTrms1 = osj_sensor_get_rms(1);
 		ampsTrms2 = osj_sensor_get_rms(2);
@@ -306,6 +590,9 @@ void laundry_core_task(void *pvParameters) {
 		waterSensorData1 = osj_sensor_get_drain(1);
 		waterSensorData2 = osj_sensor_get_drain(2);
 
+		osj_websocket_send_telemetry(1, ampsTrms1, lHour1, waterSensorData1);
+		osj_websocket_send_telemetry(2, ampsTrms2, lHour2, waterSensorData2);
+
 		isCh1Mode = !FAST_GPIO_READ(PIN_CH1_MODE);
 		isCh2Mode = !FAST_GPIO_READ(PIN_CH2_MODE);
 
@@ -325,6 +612,15 @@ void laundry_core_task(void *pvParameters) {
 								2);
 		}
 
+		cycle_checkpoint();
+		status_publish();
+
+		// Both channels have now been judged with current, drain and flow rate.
+		if (!detect_marked && lastFlowCalcTime != 0) {
+			osj_boot_mark(OSJ_BOOT_DETECT);
+			detect_marked = true;
+		}
+
 		vTaskDelay(pdMS_TO_TICKS(10));
 	}
 }
@@ -338,6 +634,10 @@ char *laundry_core_get_status_json(void) {
 							ch2CurrStatus ? "Not Working" : "Working");
 	cJSON_AddNumberToObject(root, "ch1Current", ampsTrms1);
 	cJSON_AddNumberToObject(root, "ch2Current", ampsTrms2);
+	cJSON_AddItemToObject(root, "link", osj_websocket_get_link_json());
+	cJSON_AddItemToObject(root, "time", osj_time_get_json());
+	cJSON_AddItemToObject(root, "boot", osj_boot_get_json());
+	cJSON_AddItemToObject(root, "nvs", osj_nvs_get_stats_json());
 
 	char *json_str = cJSON_PrintUnformatted(root);
 	cJSON_Delete(root);
@@ -347,4 +647,10 @@ char *laundry_core_get_status_json(void) {
 uint32_t laundry_core_get_lHour(int channel) {
 	if (channel == 1) return lHour1;
 	return lHour2;
-}
\ No newline at end of file
+}
+
+void laundry_core_get_status(laundry_status_t *out) {
+	const laundry_status_t *cur = osj_snapshot_acquire(&status_snap);
+	*out = *cur;
+	osj_snapshot_release(&status_snap, cur);
+}
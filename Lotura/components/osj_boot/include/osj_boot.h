@@ -0,0 +1,91 @@
+#ifndef OSJ_BOOT_H
+#define OSJ_BOOT_H
+
+#include "cJSON.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief 부팅 단계. 각 단계는 준비 완료 이벤트 그룹의 비트 하나에 대응한다.
+ */
+typedef enum {
+	OSJ_BOOT_NVS = 0,  ///< NVS와 설정 로드
+	OSJ_BOOT_NETIF,	   ///< esp_netif와 기본 이벤트 루프
+	OSJ_BOOT_GPIO,	   ///< GPIO
+	OSJ_BOOT_SENSOR,   ///< 유량/ADC 센서
+	OSJ_BOOT_TIME,	   ///< 시간 서비스 (RTC 복원 포함)
+	OSJ_BOOT_PUBLISHER, ///< 서버 송신 레인과 퍼블리셔 태스크
+	OSJ_BOOT_CORE,	   ///< laundry_core 태스크 생성
+	OSJ_BOOT_DETECT,   ///< 코어 태스크가 센서 값을 처음으로 모두 판정함
+	OSJ_BOOT_WIFI,	   ///< WiFi 드라이버 시작
+	OSJ_BOOT_HTTP,	   ///< HTTP 서버
+	OSJ_BOOT_REMOTE,   ///< 원격 명령 등록
+	OSJ_BOOT_LINK,	   ///< 서버 연결 요청
+	OSJ_BOOT_IP,	   ///< IP 주소 획득
+	OSJ_BOOT_SNTP,	   ///< 첫 SNTP 동기화
+	OSJ_BOOT_CONNECTED, ///< 서버와 처음 연결됨
+	OSJ_BOOT_STAGE_COUNT,
+} osj_boot_stage_t;
+
+/** @brief 단계의 준비 완료 비트 */
+#define OSJ_BOOT_BIT(stage) (1UL << (stage))
+
+/**
+ * @brief 부팅 오케스트레이터가 실행하는 단계.
+ * @details deps의 모든 비트가 설정되면 별도 태스크에서 run을 호출하고,
+ * 반환하면 stage 비트를 설정한다. 의존성이 없는 단계들은 동시에 실행된다.
+ */
+typedef struct {
+	osj_boot_stage_t stage; ///< 완료 시 설정할 단계
+	uint32_t deps;			///< 먼저 끝나야 하는 단계들의 OSJ_BOOT_BIT 합
+	void (*run)(void);		///< 초기화 함수
+	uint32_t stack;			///< 태스크 스택 크기 (0이면 4096)
+} osj_boot_step_t;
+
+/**
+ * @brief 준비 완료 이벤트 그룹을 만든다. app_main에서 가장 먼저 호출한다.
+ */
+void osj_boot_init(void);
+
+/**
+ * @brief 단계들을 의존성 순서대로, 가능한 것은 동시에 실행한다.
+ * @details 단계마다 태스크를 하나 만들고 바로 반환한다. 각 태스크는
+ * 의존 단계를 기다린 뒤 초기화 함수를 실행하고 스스로 삭제된다.
+ * @param steps 단계 배열 (실행이 끝날 때까지 유효해야 하므로 정적 배열)
+ * @param count 단계 개수
+ */
+void osj_boot_run(const osj_boot_step_t *steps, size_t count);
+
+/**
+ * @brief 단계가 끝났음을 기록한다. 처음 호출된 시각만 남는다.
+ * @details 오케스트레이터 밖에서 일어나는 단계(IP 획득, SNTP, 서버 연결,
+ * 첫 판정)는 해당 모듈이 직접 호출한다. 어느 태스크에서 호출해도 안전하다.
+ */
+void osj_boot_mark(osj_boot_stage_t stage);
+
+/**
+ * @brief 주어진 단계들이 모두 끝날 때까지 기다린다.
+ * @param stages OSJ_BOOT_BIT 합
+ * @param timeout_ms 최대 대기 시간 (밀리초)
+ * @return 모두 끝났으면 true
+ */
+bool osj_boot_wait(uint32_t stages, uint32_t timeout_ms);
+
+/**
+ * @brief 단계별 완료 시각을 "nvs 12, wifi 180, ..." 형태로 만든다.
+ * @details 시각은 전원 투입(esp_timer 0) 기준 밀리초이며, 끝난 단계만
+ * 완료 순서대로 나열한다.
+ * @return 기록한 길이
+ */
+int osj_boot_format(char *buf, size_t len);
+
+/**
+ * @brief 단계별 시작/완료 시각을 JSON으로 반환한다.
+ * @details {"nvs":{"at":12,"took":5},...} 형태이며 단위는 밀리초다.
+ * 오케스트레이터 밖의 단계는 "took"이 없다.
+ * @return cJSON 객체 (호출자가 cJSON_Delete 또는 다른 객체에 추가해야 함)
+ */
+cJSON *osj_boot_get_json(void);
+
+#endif
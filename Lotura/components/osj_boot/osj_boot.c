@@ -0,0 +1,154 @@
+#include "osj_boot.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/task.h"
+#include <inttypes.h>
+#include <stdio.h>
+
+static const char *TAG = "OSJ_BOOT";
+
+#define STEP_STACK_DEFAULT 4096
+#define STEP_PRIORITY 5
+
+static const char *const stage_names[OSJ_BOOT_STAGE_COUNT] = {
+	"nvs", "netif", "gpio", "sensor", "time", "publisher", "core", "detect",
+	"wifi", "http", "remote", "link", "ip", "sntp", "connected"};
+
+// Event group bits above 23 are reserved by FreeRTOS.
+_Static_assert(OSJ_BOOT_STAGE_COUNT <= 24, "too many boot stages");
+
+static StaticEventGroup_t ready_buf;
+static EventGroupHandle_t ready = NULL;
+static portMUX_TYPE boot_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// esp_timer time, 0 until the stage starts/finishes.
+static int64_t start_us[OSJ_BOOT_STAGE_COUNT];
+static int64_t done_us[OSJ_BOOT_STAGE_COUNT];
+
+void osj_boot_init(void) {
+	if (!ready)
+		ready = xEventGroupCreateStatic(&ready_buf);
+}
+
+static void step_task(void *arg) {
+	const osj_boot_step_t *step = arg;
+
+	if (step->deps) {
+		xEventGroupWaitBits(ready, step->deps, pdFALSE, pdTRUE,
+							portMAX_DELAY);
+	}
+	int64_t now = esp_timer_get_time();
+	portENTER_CRITICAL(&boot_mux);
+	start_us[step->stage] = now;
+	portEXIT_CRITICAL(&boot_mux);
+
+	step->run();
+	osj_boot_mark(step->stage);
+	vTaskDelete(NULL);
+}
+
+void osj_boot_run(const osj_boot_step_t *steps, size_t count) {
+	osj_boot_init();
+	for (size_t i = 0; i < count; i++) {
+		char name[configMAX_TASK_NAME_LEN];
+		snprintf(name, sizeof(name), "boot_%s", stage_names[steps[i].stage]);
+		uint32_t stack = steps[i].stack ? steps[i].stack : STEP_STACK_DEFAULT;
+		if (xTaskCreate(step_task, name, stack, (void *)&steps[i],
+						STEP_PRIORITY, NULL) != pdPASS) {
+			ESP_LOGE(TAG, "Failed to start boot step %s", name);
+		}
+	}
+}
+
+void osj_boot_mark(osj_boot_stage_t stage) {
+	if ((unsigned)stage >= OSJ_BOOT_STAGE_COUNT)
+		return;
+
+	int64_t now = esp_timer_get_time();
+	bool first = false;
+	portENTER_CRITICAL(&boot_mux);
+	if (done_us[stage] == 0) {
+		done_us[stage] = now;
+		first = true;
+	}
+	int64_t started = start_us[stage];
+	portEXIT_CRITICAL(&boot_mux);
+	if (!first)
+		return;
+
+	if (ready)
+		xEventGroupSetBits(ready, OSJ_BOOT_BIT(stage));
+	if (started) {
+		ESP_LOGI(TAG, "%s ready at %" PRId64 " ms (took %" PRId64 " ms)",
+				 stage_names[stage], now / 1000, (now - started) / 1000);
+	} else {
+		ESP_LOGI(TAG, "%s at %" PRId64 " ms", stage_names[stage], now / 1000);
+	}
+}
+
+bool osj_boot_wait(uint32_t stages, uint32_t timeout_ms) {
+	if (!ready)
+		return false;
+	EventBits_t bits = xEventGroupWaitBits(ready, stages, pdFALSE, pdTRUE,
+										   pdMS_TO_TICKS(timeout_ms));
+	return (bits & stages) == stages;
+}
+
+static void snapshot(int64_t *starts, int64_t *dones) {
+	portENTER_CRITICAL(&boot_mux);
+	for (int i = 0; i < OSJ_BOOT_STAGE_COUNT; i++) {
+		starts[i] = start_us[i];
+		dones[i] = done_us[i];
+	}
+	portEXIT_CRITICAL(&boot_mux);
+}
+
+int osj_boot_format(char *buf, size_t len) {
+	int64_t starts[OSJ_BOOT_STAGE_COUNT], dones[OSJ_BOOT_STAGE_COUNT];
+	snapshot(starts, dones);
+
+	// Finished stages in completion order.
+	int order[OSJ_BOOT_STAGE_COUNT];
+	int n = 0;
+	for (int i = 0; i < OSJ_BOOT_STAGE_COUNT; i++) {
+		if (dones[i] == 0)
+			continue;
+		int j = n++;
+		while (j > 0 && dones[order[j - 1]] > dones[i]) {
+			order[j] = order[j - 1];
+			j--;
+		}
+		order[j] = i;
+	}
+
+	size_t used = 0;
+	if (len > 0)
+		buf[0] = '\0';
+	for (int k = 0; k < n && used < len; k++) {
+		int w = snprintf(buf + used, len - used, "%s%s %" PRId64, k ? ", " : "",
+						 stage_names[order[k]], dones[order[k]] / 1000);
+		if (w < 0)
+			break;
+		used += (size_t)w;
+	}
+	return used < len ? (int)used : (int)(len ? len - 1 : 0);
+}
+
+cJSON *osj_boot_get_json(void) {
+	int64_t starts[OSJ_BOOT_STAGE_COUNT], dones[OSJ_BOOT_STAGE_COUNT];
+	snapshot(starts, dones);
+
+	cJSON *obj = cJSON_CreateObject();
+	for (int i = 0; i < OSJ_BOOT_STAGE_COUNT; i++) {
+		if (dones[i] == 0)
+			continue;
+		cJSON *st = cJSON_AddObjectToObject(obj, stage_names[i]);
+		cJSON_AddNumberToObject(st, "at", (double)(dones[i] / 1000));
+		if (starts[i])
+			cJSON_AddNumberToObject(st, "took",
+									(double)((dones[i] - starts[i]) / 1000));
+	}
+	return obj;
+}
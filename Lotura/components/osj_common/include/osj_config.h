@@ -1,40 +1,122 @@
 #ifndef OSJ_CONFIG_H
 #define OSJ_CONFIG_H
 
+#include "cJSON.h"
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+
+/** @brief 원격(SetConfig)으로 바꿀 수 있는 필드 */
+#define OSJ_CFG_REMOTE 0x01
+/** @brief 상태 페이지나 JSON으로 내보내지 않는 필드 */
+#define OSJ_CFG_SECRET 0x02
+
+/**
+ * @brief 설정 필드 목록. SystemConfig 구조체, 기본값, NVS 로더, 검사,
+ * HTTP 렌더링, JSON 내보내기가 모두 이 목록에서 만들어진다.
+ * @details STR(이름, 크기, 기본값, 플래그),
+ * FLOAT/UINT(이름, 기본값, 최솟값, 최댓값, 플래그), BOOL(이름, 기본값, 플래그).
+ * 이름은 NVS 키와 HTML 토큰으로도 쓰인다.
+ * @note 저장된 설정 레코드가 구조체를 그대로 담으므로, 새 필드는 끝에만
+ * 추가한다.
+ */
+#define OSJ_CONFIG_FIELDS(STR, FLOAT, UINT, BOOL)                              \
+	STR(apSsid, 32, "", 0)                                                     \
+	STR(apPasswd, 64, "", OSJ_CFG_SECRET)                                      \
+	STR(roomNo, 16, "0", 0)                                                    \
+	STR(authId, 32, "", 0)                                                     \
+	STR(authPasswd, 32, "", OSJ_CFG_SECRET)                                    \
+	STR(ch1DeviceNo, 8, "1", 0)                                                \
+	STR(ch2DeviceNo, 8, "2", 0)                                                \
+	FLOAT(ch1CurrW, 0.2f, 0, 100, OSJ_CFG_REMOTE)                              \
+	FLOAT(ch2CurrW, 0.2f, 0, 100, OSJ_CFG_REMOTE)                              \
+	UINT(ch1FlowW, 50, 0, 100000, OSJ_CFG_REMOTE)                              \
+	UINT(ch2FlowW, 50, 0, 100000, OSJ_CFG_REMOTE)                              \
+	FLOAT(ch1CurrD, 0.5f, 0, 100, OSJ_CFG_REMOTE)                              \
+	FLOAT(ch2CurrD, 0.5f, 0, 100, OSJ_CFG_REMOTE)                              \
+	UINT(ch1EndDelayW, 100000, 0, 3600000, OSJ_CFG_REMOTE)                     \
+	UINT(ch2EndDelayW, 100000, 0, 3600000, OSJ_CFG_REMOTE)                     \
+	UINT(ch1EndDelayD, 10000, 0, 3600000, OSJ_CFG_REMOTE)                      \
+	UINT(ch2EndDelayD, 10000, 0, 3600000, OSJ_CFG_REMOTE)                      \
+	BOOL(isCh1Live, true, OSJ_CFG_REMOTE)                                      \
+	BOOL(isCh2Live, true, OSJ_CFG_REMOTE)                                      \
+	FLOAT(hysteresisMargin, 0.05f, 0, 10, 0)
+
+#define OSJ_CFG_DECL_STR(name, len, def, flags) char name[len];
+#define OSJ_CFG_DECL_FLOAT(name, def, lo, hi, flags) float name;
+#define OSJ_CFG_DECL_UINT(name, def, lo, hi, flags) uint32_t name;
+#define OSJ_CFG_DECL_BOOL(name, def, flags) bool name;
 
 typedef struct {
-    char apSsid[32];
-    char apPasswd[64];
-    char roomNo[16];
-    char authId[32];
-    char authPasswd[32];
-    
-    char ch1DeviceNo[8];
-    char ch2DeviceNo[8];
-    
-    float ch1CurrW;
-    float ch2CurrW;
-    uint32_t ch1FlowW;
-    uint32_t ch2FlowW;
-    float ch1CurrD;
-    float ch2CurrD;
-    
-    uint32_t ch1EndDelayW;
-    uint32_t ch2EndDelayW;
-    uint32_t ch1EndDelayD;
-    uint32_t ch2EndDelayD;
-    
-    bool isCh1Live;
-    bool isCh2Live;
-    
-    float hysteresisMargin;
+	OSJ_CONFIG_FIELDS(OSJ_CFG_DECL_STR, OSJ_CFG_DECL_FLOAT, OSJ_CFG_DECL_UINT,
+					  OSJ_CFG_DECL_BOOL)
 } SystemConfig;
 
-extern SystemConfig sys_config;
+/**
+ * @brief 현재 설정을 잠금 없이 빌린다. osj_config_release()로 돌려줘야 한다.
+ * @details 설정을 바꾸는 쪽은 새 사본을 만들어 공개하므로, 빌린 동안 값은
+ * 바뀌지 않고 필드들은 항상 같은 커밋의 값이다. 빌린 채로 블로킹하지 않는다.
+ */
+const SystemConfig *osj_config_acquire(void);
+
+/**
+ * @brief osj_config_acquire()로 빌린 설정을 돌려준다.
+ */
+void osj_config_release(const SystemConfig *cfg);
+
+/**
+ * @brief 설정이 바뀔 때마다 1씩 증가하는 세대 번호를 반환한다.
+ * @details 원자적 읽기 한 번이므로, 설정에서 파생된 사본이나 캐시를 다시
+ * 만들 필요가 있는지 매 루프 확인하는 데 쓴다.
+ */
+uint32_t osj_config_generation(void);
+
+typedef enum {
+	OSJ_CFG_STR = 0,
+	OSJ_CFG_FLOAT,
+	OSJ_CFG_UINT,
+	OSJ_CFG_BOOL,
+} osj_config_type_t;
+
+/**
+ * @brief 설정 필드 하나의 메타데이터.
+ */
+typedef struct {
+	const char *key;		///< 필드 이름 (NVS 키, HTML 토큰)
+	osj_config_type_t type; ///< 값 종류
+	uint16_t offset;		///< SystemConfig 안의 위치
+	uint16_t size;			///< 필드 크기 (문자열은 NUL 포함 버퍼 크기)
+	float min;				///< 숫자 필드의 최솟값
+	float max;				///< 숫자 필드의 최댓값
+	uint8_t flags;			///< OSJ_CFG_REMOTE, OSJ_CFG_SECRET
+} osj_config_field_t;
+
+/**
+ * @brief 키로 설정 필드를 찾는다 (정렬된 색인에서 이진 탐색).
+ * @param key 필드 이름
+ * @param len 키 길이 (NUL로 끝나지 않는 토큰도 찾을 수 있다)
+ * @return 필드, 없으면 NULL
+ */
+const osj_config_field_t *osj_config_find(const char *key, size_t len);
+
+/**
+ * @brief 필드 개수와 선언 순서상 i번째 필드를 반환한다.
+ */
+size_t osj_config_field_count(void);
+const osj_config_field_t *osj_config_field_at(size_t i);
+
+/**
+ * @brief 필드 값을 문자열로 만든다. 실수는 소수 둘째 자리, 논리값은
+ * "true"/"false".
+ * @return 기록한 길이
+ */
+int osj_config_format(const SystemConfig *cfg, const osj_config_field_t *f,
+					  char *buf, size_t len);
 
-void osj_config_lock(void);
-void osj_config_unlock(void);
+/**
+ * @brief 비밀이 아닌 필드를 {"키": 값, ...} JSON으로 내보낸다.
+ * @return cJSON 객체 (호출자가 cJSON_Delete 또는 다른 객체에 추가해야 함)
+ */
+cJSON *osj_config_get_json(void);
 
 #endif
@@ -0,0 +1,82 @@
+#ifndef OSJ_SNAPSHOT_H
+#define OSJ_SNAPSHOT_H
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * @brief 읽기 쪽이 잠금 없이 일관된 사본을 보는 이중 버퍼.
+ * @details 쓰는 쪽은 쓰이지 않는 버퍼에 새 값을 만든 뒤 포인터 인덱스를
+ * 원자적으로 바꿔 공개한다. 읽는 쪽은 인덱스를 읽고 그 버퍼의 독자 수를
+ * 올린다. 쓰는 쪽은 예비 버퍼를 재사용하기 전에 그 버퍼의 독자가 모두
+ * 떠날 때까지 기다린다. 읽기는 절대 블로킹하지 않는다.
+ * @note 쓰는 쪽끼리는 호출자가 직렬화해야 한다.
+ */
+typedef struct {
+	void *slot[2];
+	size_t size;
+	atomic_uint current;	///< 공개된 버퍼 인덱스
+	atomic_uint readers[2]; ///< 버퍼별 현재 독자 수
+	atomic_uint version;	///< 공개할 때마다 1씩 증가
+} osj_snapshot_t;
+
+/**
+ * @brief 두 버퍼로 스냅샷을 초기화하고 initial을 첫 값으로 공개한다.
+ */
+static inline void osj_snapshot_init(osj_snapshot_t *s, void *a, void *b,
+									 size_t size, const void *initial) {
+	s->slot[0] = a;
+	s->slot[1] = b;
+	s->size = size;
+	memcpy(a, initial, size);
+	atomic_init(&s->readers[0], 0);
+	atomic_init(&s->readers[1], 0);
+	atomic_init(&s->current, 0);
+	atomic_init(&s->version, 1);
+}
+
+/**
+ * @brief 현재 공개된 값을 빌린다. osj_snapshot_release()로 돌려줘야 한다.
+ * @details 빌린 동안 값은 바뀌지 않는다. 쓰는 쪽이 기다리게 되므로 빌린
+ * 채로 블로킹하지 않는다.
+ */
+static inline const void *osj_snapshot_acquire(osj_snapshot_t *s) {
+	for (;;) {
+		unsigned idx = atomic_load(&s->current);
+		atomic_fetch_add(&s->readers[idx], 1);
+		// A writer may have republished and started reusing idx between the
+		// load and the increment. Seeing the same index again rules that out.
+		if (atomic_load(&s->current) == idx)
+			return s->slot[idx];
+		atomic_fetch_sub(&s->readers[idx], 1);
+	}
+}
+
+static inline void osj_snapshot_release(osj_snapshot_t *s, const void *p) {
+	atomic_fetch_sub(&s->readers[p == s->slot[1] ? 1 : 0], 1);
+}
+
+/**
+ * @brief 공개 횟수. 값이 바뀌었는지 잠금 없이 확인할 때 쓴다.
+ */
+static inline uint32_t osj_snapshot_version(osj_snapshot_t *s) {
+	return atomic_load(&s->version);
+}
+
+/**
+ * @brief value를 새 값으로 공개한다.
+ * @details 예비 버퍼에 남은 독자가 있으면 떠날 때까지 한 틱씩 기다린다.
+ */
+static inline void osj_snapshot_publish(osj_snapshot_t *s, const void *value) {
+	unsigned spare = atomic_load(&s->current) ^ 1;
+	while (atomic_load(&s->readers[spare]) != 0)
+		vTaskDelay(1);
+	memcpy(s->slot[spare], value, s->size);
+	atomic_store(&s->current, spare);
+	atomic_fetch_add(&s->version, 1);
+}
+
+#endif
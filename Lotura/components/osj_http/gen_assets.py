@@ -0,0 +1,110 @@
+# SPDX-License-Identifier: Unlicense OR CC0-1.0
+"""Gzips the static web assets into the table osj_http serves them from.
+
+index.html is served at / and every other file at /<name>. Each asset gets
+a strong ETag from the SHA-256 of its gzip bytes. In HTML assets, a quoted
+"/<name>" that names another asset is rewritten to "/<name>?v=<tag>", so
+the referenced file can be cached for good and the page picks up a new
+URL whenever the file changes. HTML itself is sent with no-cache and is
+revalidated with If-None-Match on every load.
+"""
+import argparse
+import gzip
+import hashlib
+import os
+
+TYPES = {
+    '.html': 'text/html',
+    '.css': 'text/css',
+    '.js': 'application/javascript',
+    '.svg': 'image/svg+xml',
+    '.ico': 'image/x-icon',
+    '.png': 'image/png',
+}
+
+CACHE_REVALIDATE = 'no-cache'
+CACHE_IMMUTABLE = 'public, max-age=31536000, immutable'
+
+
+def compress(raw):
+    # mtime=0 keeps the output, and so the ETag, identical across builds.
+    return gzip.compress(raw, compresslevel=9, mtime=0)
+
+
+def tag(gz):
+    return hashlib.sha256(gz).hexdigest()[:16]
+
+
+def c_bytes(data):
+    lines = []
+    for i in range(0, len(data), 16):
+        lines.append('\t' + ' '.join('0x{:02x},'.format(b)
+                                     for b in data[i:i + 16]))
+    return '\n'.join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('output')
+    parser.add_argument('assets', nargs='+')
+    args = parser.parse_args()
+
+    assets = []
+    for path in args.assets:
+        name = os.path.basename(path)
+        ext = os.path.splitext(name)[1]
+        if ext not in TYPES:
+            raise SystemExit('gen_assets: {}: unknown type'.format(path))
+        with open(path, 'rb') as f:
+            raw = f.read()
+        assets.append({
+            'name': name,
+            'uri': '/' if name == 'index.html' else '/' + name,
+            'type': TYPES[ext],
+            'raw': raw,
+            'cache': CACHE_REVALIDATE,
+        })
+
+    # Version the references first, then hash the pages that hold them.
+    versions = {}
+    for a in assets:
+        if a['type'] != 'text/html':
+            a['gz'] = compress(a['raw'])
+            versions[a['uri']] = tag(a['gz'])
+    for a in assets:
+        if a['type'] != 'text/html':
+            continue
+        for uri, v in versions.items():
+            ref = '"{}"'.format(uri).encode()
+            if ref in a['raw']:
+                a['raw'] = a['raw'].replace(
+                    ref, '"{}?v={}"'.format(uri, v).encode())
+                next(b for b in assets if b['uri'] == uri)['cache'] = \
+                    CACHE_IMMUTABLE
+        a['gz'] = compress(a['raw'])
+
+    out = ['/* Generated by gen_assets.py. Do not edit. */',
+           '#include "osj_assets.h"', '']
+    rows = []
+    for i, a in enumerate(assets):
+        out.append('/* {}: {} bytes, {} gzipped */'.format(
+            a['name'], len(a['raw']), len(a['gz'])))
+        out.append('static const uint8_t asset{}[] = {{'.format(i))
+        out.append(c_bytes(a['gz']))
+        out.append('};')
+        out.append('')
+        rows.append('\t{{"{}", "{}", "{}", "\\"{}\\"", asset{}, {}, {}}},'
+                    .format(a['uri'], a['type'], a['cache'], tag(a['gz']), i,
+                            len(a['gz']), len(a['raw'])))
+    out.append('const osj_asset_t osj_assets[] = {')
+    out.extend(rows)
+    out.append('};')
+    out.append('')
+    out.append('const size_t osj_asset_count = {};'.format(len(assets)))
+
+    with open(args.output, 'w', newline='\n') as f:
+        f.write('\n'.join(out) + '\n')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,129 @@
+# SPDX-License-Identifier: Unlicense OR CC0-1.0
+"""Compiles html/info.html into the segment table osj_http renders from.
+
+Every %name% in the page must be a page field from OSJ_TPL_PAGE_FIELDS
+(osj_template.h) or a non-secret field from OSJ_CONFIG_FIELDS
+(osj_config.h); anything else fails the build with the offending line. A
+'%' that is not followed by a name and a closing '%' is plain text, and
+'%%' is a literal '%'.
+"""
+import argparse
+import re
+import sys
+
+TOKEN = re.compile(r'%([A-Za-z0-9_]*)%')
+PAGE_FIELD = re.compile(r'^\s*X\((\w+)\)', re.M)
+CONFIG_FIELD = re.compile(r'^\s*(STR|FLOAT|UINT|BOOL)\((\w+),([^)]*)\)', re.M)
+
+
+def macro_body(text, name):
+    """Returns the continuation lines of '#define name(...)'."""
+    m = re.search(r'#define\s+' + name + r'\([^)]*\)(.*?)(?<!\\)\n', text,
+                  re.S)
+    if not m:
+        sys.exit('gen_page: {} not found'.format(name))
+    return m.group(1).replace('\\\n', '\n')
+
+
+def known_fields(template_h, config_h):
+    with open(template_h) as f:
+        page = PAGE_FIELD.findall(macro_body(f.read(), 'OSJ_TPL_PAGE_FIELDS'))
+    with open(config_h) as f:
+        config = CONFIG_FIELD.findall(macro_body(f.read(), 'OSJ_CONFIG_FIELDS'))
+    fields = set(page)
+    secret = set()
+    for _, name, args in config:
+        (secret if 'OSJ_CFG_SECRET' in args else fields).add(name)
+    return fields, secret
+
+
+def c_string(text):
+    out = []
+    for ch in text.encode('utf-8'):
+        if ch == 0x5c:
+            out.append('\\\\')
+        elif ch == 0x22:
+            out.append('\\"')
+        elif ch == 0x0a:
+            out.append('\\n"\n\t"')
+        elif 0x20 <= ch < 0x7f:
+            out.append(chr(ch))
+        else:
+            # Octal keeps a following hex digit from joining the escape.
+            out.append('\\{:03o}'.format(ch))
+    return '"' + ''.join(out) + '"'
+
+
+def split(html, fields, secret, path):
+    segments = []
+    literal = []
+    errors = []
+    pos = 0
+    for m in TOKEN.finditer(html):
+        if m.start() < pos:
+            continue
+        name = m.group(1)
+        literal.append(html[pos:m.start()])
+        pos = m.end()
+        if name == '':
+            literal.append('%')
+            continue
+        if name not in fields:
+            line = html.count('\n', 0, m.start()) + 1
+            why = 'secret config field' if name in secret else 'unknown token'
+            errors.append('{}:{}: {} %{}%'.format(path, line, why, name))
+            continue
+        if literal:
+            segments.append(('lit', ''.join(literal)))
+            literal = []
+        segments.append(('field', name))
+    literal.append(html[pos:])
+    text = ''.join(literal)
+    if text:
+        segments.append(('lit', text))
+    return [s for s in segments if s != ('lit', '')], errors
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('html')
+    parser.add_argument('template_h')
+    parser.add_argument('config_h')
+    parser.add_argument('output')
+    args = parser.parse_args()
+
+    fields, secret = known_fields(args.template_h, args.config_h)
+    with open(args.html, encoding='utf-8') as f:
+        html = f.read()
+    segments, errors = split(html, fields, secret, args.html)
+    if errors:
+        sys.exit('\n'.join(errors))
+
+    out = ['/* Generated by gen_page.py from {}. Do not edit. */'.format(
+               args.html.replace('\\', '/').split('/')[-1]),
+           '#include "osj_template.h"', '']
+    rows = []
+    literal_bytes = 0
+    for i, (kind, value) in enumerate(segments):
+        if kind == 'lit':
+            size = len(value.encode('utf-8'))
+            literal_bytes += size
+            out.append('static const char lit{}[] =\n\t{};'.format(
+                i, c_string(value)))
+            rows.append('\t{{lit{}, {}, OSJ_TPL_LITERAL}},'.format(i, size))
+        else:
+            rows.append('\t{{NULL, 0, OSJ_TPL_F_{}}},'.format(value))
+    out.append('')
+    out.append('static const osj_tpl_segment_t segments[] = {')
+    out.extend(rows)
+    out.append('};')
+    out.append('')
+    out.append('const osj_tpl_t osj_page = {{segments, {}, {}}};'.format(
+        len(segments), literal_bytes))
+
+    with open(args.output, 'w', newline='\n') as f:
+        f.write('\n'.join(out) + '\n')
+
+
+if __name__ == '__main__':
+    main()
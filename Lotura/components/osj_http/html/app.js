@@ -0,0 +1,132 @@
+function validateFormUpdate() {
+    var inputElement = document.getElementById('update');
+    var files = inputElement.files;
+    if (files.length == 0) {
+        alert("File Not Selected");
+        return false;
+    }
+    performOTA(files[0]);
+    return false;
+}
+
+function performOTA(file) {
+    var statusDiv = document.getElementById('ota_status');
+    statusDiv.innerHTML = "Uploading " + file.name + "...";
+
+    var xhr = new XMLHttpRequest();
+    xhr.open("POST", "/update", true);
+
+    xhr.upload.onprogress = function (e) {
+        if (e.lengthComputable) {
+            var percentComplete = (e.loaded / e.total) * 100;
+            statusDiv.innerHTML = "Upload: " + percentComplete.toFixed(2) + "%";
+        }
+    };
+
+    xhr.onload = function () {
+        if (xhr.status == 200) {
+            statusDiv.innerHTML = "Update Success! Rebooting...";
+            alert("Update Success! Device will reboot.");
+        } else {
+            statusDiv.innerHTML = "Update Failed: " + xhr.status;
+            alert("Update Failed!");
+        }
+    };
+
+    xhr.onerror = function () {
+        statusDiv.innerHTML = "Unknown Error";
+        alert("Network Error");
+    };
+
+    xhr.send(file);
+}
+
+function confirmFormat() {
+    var text = "Are you sure?";
+    if (confirm(text) == true) {
+        return true;
+    }
+    else {
+        return false;
+    }
+}
+function callSetDefaultVal() {
+    return true;
+}
+
+// The page itself is static and cached; device values come from /info.
+function loadInfo() {
+    var xhr = new XMLHttpRequest();
+    xhr.open("GET", "/info", true);
+    xhr.onload = function () {
+        if (xhr.status != 200) {
+            return;
+        }
+        var infoDiv = document.getElementById('info');
+        infoDiv.innerHTML = xhr.responseText;
+        var table = infoDiv.firstElementChild;
+        var name = table && table.getAttribute('data-name');
+        if (name) {
+            document.getElementById('device_name').textContent = name;
+            document.title = name;
+        }
+        watchLive();
+    };
+    xhr.send();
+}
+
+var live = null;
+
+// Keeps the current, drain and flow cells up to date from /ws/live while
+// the tab is visible. A hidden tab closes its socket so the device, which
+// only has a few viewer slots, gets the slot back at once.
+function watchLive() {
+    if (!window.WebSocket) {
+        return;
+    }
+    document.addEventListener('visibilitychange', function () {
+        if (document.hidden) {
+            stopLive();
+        } else {
+            startLive();
+        }
+    });
+    if (!document.hidden) {
+        startLive();
+    }
+}
+
+function startLive() {
+    if (live) {
+        return;
+    }
+    var ws = new WebSocket("ws://" + location.host + "/ws/live?hz=2");
+    ws.onmessage = function (e) {
+        var frame = JSON.parse(e.data);
+        for (var i = 0; i < frame.ch.length; i++) {
+            var n = i + 1;
+            var amps = document.getElementById('amps' + n);
+            if (!amps) {
+                return;
+            }
+            amps.textContent = frame.ch[i].amps.toFixed(2);
+            document.getElementById('drain' + n).textContent = frame.ch[i].drain;
+            document.getElementById('flow' + n).textContent = frame.ch[i].lHour;
+        }
+    };
+    ws.onclose = function () {
+        if (live === ws) {
+            live = null;
+        }
+    };
+    live = ws;
+}
+
+function stopLive() {
+    if (live) {
+        live.close();
+        live = null;
+    }
+}
+
+loadInfo();
@@ -0,0 +1,300 @@
+#include "osj_api.h"
+#include "cJSON.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "laundry_core.h"
+#include "osj_config.h"
+#include "osj_nvs.h"
+#include "osj_websocket.h"
+#include "osj_wifi.h"
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "OSJ_API";
+
+#define CHANNEL_PREFIX "/api/channels/"
+
+// Handlers run one at a time on the server task, so responses are built in
+// static buffers. The config body only changes on commit and is kept until
+// the generation moves.
+static char api_buf[768];
+static char config_buf[1024];
+static size_t config_len = 0;
+static uint32_t config_gen = 0;
+
+// Fields the websocket handshake is built from; changing one reconnects.
+static const char *const identity_keys[] = {"roomNo", "authId", "authPasswd",
+											"ch1DeviceNo", "ch2DeviceNo"};
+
+typedef struct {
+	char *buf;
+	size_t cap;
+	size_t len;
+	bool full;
+} json_out_t;
+
+static void out_fmt(json_out_t *o, const char *fmt, ...) {
+	if (o->full)
+		return;
+	va_list ap;
+	va_start(ap, fmt);
+	int n = vsnprintf(o->buf + o->len, o->cap - o->len, fmt, ap);
+	va_end(ap);
+	if (n < 0 || (size_t)n >= o->cap - o->len)
+		o->full = true;
+	else
+		o->len += n;
+}
+
+static void out_str(json_out_t *o, const char *s) {
+	out_fmt(o, "\"");
+	for (; *s && !o->full; s++) {
+		unsigned char ch = *s;
+		if (ch == '"' || ch == '\\')
+			out_fmt(o, "\\%c", ch);
+		else if (ch < 0x20)
+			out_fmt(o, "\\u%04x", ch);
+		else
+			out_fmt(o, "%c", ch);
+	}
+	out_fmt(o, "\"");
+}
+
+static void out_field(json_out_t *o, const SystemConfig *cfg,
+					  const osj_config_field_t *f, const char *name) {
+	char val[72];
+	osj_config_format(cfg, f, val, sizeof(val));
+	out_str(o, name);
+	out_fmt(o, ":");
+	if (f->type == OSJ_CFG_STR)
+		out_str(o, val);
+	else
+		out_fmt(o, "%s", val);
+}
+
+// "ch1CurrW" -> "currW" and "isCh1Live" -> "live" for channel 1; false for
+// fields that do not belong to channel n.
+static bool channel_key(const char *key, int n, char *out, size_t len) {
+	char prefix[8];
+	const char *rest = NULL;
+	snprintf(prefix, sizeof(prefix), "ch%d", n);
+	if (strncmp(key, prefix, 3) == 0)
+		rest = key + 3;
+	snprintf(prefix, sizeof(prefix), "isCh%d", n);
+	if (strncmp(key, prefix, 5) == 0)
+		rest = key + 5;
+	if (!rest || *rest < 'A' || *rest > 'Z')
+		return false;
+	snprintf(out, len, "%c%s", *rest - 'A' + 'a', rest + 1);
+	return true;
+}
+
+static void out_channel(json_out_t *o, int n, const laundry_channel_status_t *c) {
+	out_fmt(o,
+			"{\"n\":%d,\"mode\":\"%s\",\"running\":%s,\"cycleMs\":%lld,"
+			"\"amps\":%.3f,\"lHour\":%lu,\"drain\":%d",
+			n, c->dryer ? "dry" : "wash", c->running ? "true" : "false",
+			c->cycle_ms, c->amps, c->lHour, c->drain);
+}
+
+static esp_err_t send_json(httpd_req_t *req, const json_out_t *o) {
+	if (o->full) {
+		ESP_LOGE(TAG, "%s: response exceeds %u bytes", req->uri,
+				 (unsigned)o->cap);
+		return httpd_resp_send_500(req);
+	}
+	httpd_resp_set_type(req, "application/json");
+	httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+	return httpd_resp_send(req, o->buf, o->len);
+}
+
+static esp_err_t send_error(httpd_req_t *req, const char *status,
+							const char *error, const char *key) {
+	json_out_t o = {.buf = api_buf, .cap = sizeof(api_buf)};
+	out_fmt(&o, "{\"error\":");
+	out_str(&o, error);
+	if (key) {
+		out_fmt(&o, ",\"key\":");
+		out_str(&o, key);
+	}
+	out_fmt(&o, "}");
+	httpd_resp_set_status(req, status);
+	send_json(req, &o);
+	return ESP_FAIL;
+}
+
+static esp_err_t status_get_handler(httpd_req_t *req) {
+	laundry_status_t st;
+	laundry_core_get_status(&st);
+	char ip[16];
+	osj_wifi_get_ip(ip);
+
+	json_out_t o = {.buf = api_buf, .cap = sizeof(api_buf)};
+	out_fmt(&o,
+			"{\"seq\":%lu,\"atMs\":%lld,\"uptimeMs\":%lld,\"heap\":%lu,"
+			"\"rssi\":%d,\"ip\":\"%s\",\"configGen\":%lu,\"channels\":[",
+			st.seq, st.at_ms, esp_timer_get_time() / 1000,
+			esp_get_free_heap_size(), osj_wifi_get_rssi(), ip,
+			osj_config_generation());
+	for (int i = 0; i < 2; i++) {
+		out_channel(&o, i + 1, &st.ch[i]);
+		out_fmt(&o, i == 0 ? "}," : "}");
+	}
+	out_fmt(&o, "]}");
+	return send_json(req, &o);
+}
+
+static esp_err_t channel_get_handler(httpd_req_t *req) {
+	const char *p = req->uri + strlen(CHANNEL_PREFIX);
+	int n = p[0] - '0';
+	if ((n != 1 && n != 2) || (p[1] != '\0' && p[1] != '?')) {
+		httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "No such channel");
+		return ESP_FAIL;
+	}
+
+	laundry_status_t st;
+	laundry_core_get_status(&st);
+	SystemConfig cfg;
+	const SystemConfig *cur = osj_config_acquire();
+	cfg = *cur;
+	osj_config_release(cur);
+
+	json_out_t o = {.buf = api_buf, .cap = sizeof(api_buf)};
+	out_channel(&o, n, &st.ch[n - 1]);
+	out_fmt(&o, ",\"seq\":%lu,\"atMs\":%lld,\"config\":{", st.seq, st.at_ms);
+	bool first = true;
+	for (size_t i = 0; i < osj_config_field_count(); i++) {
+		const osj_config_field_t *f = osj_config_field_at(i);
+		char name[24];
+		if ((f->flags & OSJ_CFG_SECRET) ||
+			!channel_key(f->key, n, name, sizeof(name)))
+			continue;
+		if (!first)
+			out_fmt(&o, ",");
+		out_field(&o, &cfg, f, name);
+		first = false;
+	}
+	out_fmt(&o, "}}");
+	return send_json(req, &o);
+}
+
+static esp_err_t send_config(httpd_req_t *req) {
+	uint32_t gen = osj_config_generation();
+	if (config_gen != gen) {
+		SystemConfig cfg;
+		const SystemConfig *cur = osj_config_acquire();
+		cfg = *cur;
+		osj_config_release(cur);
+
+		json_out_t o = {.buf = config_buf, .cap = sizeof(config_buf)};
+		out_fmt(&o, "{\"generation\":%lu", gen);
+		for (size_t i = 0; i < osj_config_field_count(); i++) {
+			const osj_config_field_t *f = osj_config_field_at(i);
+			if (f->flags & OSJ_CFG_SECRET)
+				continue;
+			out_fmt(&o, ",");
+			out_field(&o, &cfg, f, f->key);
+		}
+		out_fmt(&o, "}");
+		if (o.full)
+			return send_json(req, &o);
+		config_len = o.len;
+		config_gen = gen;
+	}
+	json_out_t cached = {.buf = config_buf, .cap = sizeof(config_buf),
+						 .len = config_len};
+	return send_json(req, &cached);
+}
+
+static esp_err_t config_get_handler(httpd_req_t *req) {
+	return send_config(req);
+}
+
+static bool identity_changed(const SystemConfig *a, const SystemConfig *b) {
+	for (size_t i = 0; i < sizeof(identity_keys) / sizeof(identity_keys[0]);
+		 i++) {
+		const osj_config_field_t *f =
+			osj_config_find(identity_keys[i], strlen(identity_keys[i]));
+		if (f && memcmp((const char *)a + f->offset,
+						(const char *)b + f->offset, f->size) != 0)
+			return true;
+	}
+	return false;
+}
+
+// PATCH /api/config takes {"key": value, ...} and applies it as one
+// transaction: either every field changes or none does. Secret fields can
+// be written but are never returned.
+static esp_err_t config_patch_handler(httpd_req_t *req) {
+	char body[512];
+	if (req->content_len >= sizeof(body))
+		return send_error(req, "413 Payload Too Large", "body too large",
+						  NULL);
+	size_t got = 0;
+	while (got < req->content_len) {
+		int ret = httpd_req_recv(req, body + got, req->content_len - got);
+		if (ret <= 0) {
+			if (ret == HTTPD_SOCK_ERR_TIMEOUT)
+				httpd_resp_send_408(req);
+			return ESP_FAIL;
+		}
+		got += ret;
+	}
+
+	cJSON *root = cJSON_ParseWithLength(body, got);
+	if (!cJSON_IsObject(root)) {
+		cJSON_Delete(root);
+		return send_error(req, "400 Bad Request", "expected a JSON object",
+						  NULL);
+	}
+
+	osj_config_txn_t txn;
+	osj_config_begin(&txn);
+	SystemConfig before = txn.next;
+	for (const cJSON *it = root->child; it; it = it->next) {
+		const osj_config_field_t *f =
+			osj_config_find(it->string, strlen(it->string));
+		esp_err_t err = f ? osj_config_set_json(&txn, f, it) : ESP_ERR_NOT_FOUND;
+		if (err != ESP_OK) {
+			osj_config_abort(&txn);
+			send_error(req, "400 Bad Request", esp_err_to_name(err),
+					   it->string);
+			cJSON_Delete(root);
+			return ESP_FAIL;
+		}
+	}
+	cJSON_Delete(root);
+
+	esp_err_t err = osj_config_commit(&txn);
+	if (err != ESP_OK)
+		return send_error(req, "400 Bad Request", esp_err_to_name(err),
+						  txn.bad_key);
+	if (identity_changed(&before, &txn.next)) {
+		uint32_t ticket = osj_websocket_restart();
+		ESP_LOGI(TAG, "Identity changed, websocket restart #%lu queued",
+				 ticket);
+	}
+	return send_config(req);
+}
+
+void osj_api_register(httpd_handle_t server) {
+	const httpd_uri_t uris[OSJ_API_URI_COUNT] = {
+		{.uri = "/api/status",
+		 .method = HTTP_GET,
+		 .handler = status_get_handler},
+		{.uri = CHANNEL_PREFIX "*",
+		 .method = HTTP_GET,
+		 .handler = channel_get_handler},
+		{.uri = "/api/config",
+		 .method = HTTP_GET,
+		 .handler = config_get_handler},
+		{.uri = "/api/config",
+		 .method = HTTP_PATCH,
+		 .handler = config_patch_handler},
+	};
+	for (size_t i = 0; i < OSJ_API_URI_COUNT; i++)
+		httpd_register_uri_handler(server, &uris[i]);
+}
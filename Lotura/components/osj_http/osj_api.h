@@ -0,0 +1,17 @@
+#ifndef OSJ_API_H
+#define OSJ_API_H
+
+#include "esp_http_server.h"
+
+/** @brief osj_api_register()가 등록하는 URI 핸들러 수 */
+#define OSJ_API_URI_COUNT 4
+
+/**
+ * @brief JSON API 핸들러를 등록한다.
+ * @details GET /api/status, GET /api/channels/{1|2}, GET·PATCH /api/config.
+ * 채널 경로 때문에 서버는 httpd_uri_match_wildcard로 시작해야 한다.
+ * 응답은 모두 서버 태스크의 정적 버퍼에 직렬화한다.
+ */
+void osj_api_register(httpd_handle_t server);
+
+#endif
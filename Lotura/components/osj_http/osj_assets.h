@@ -0,0 +1,29 @@
+#ifndef OSJ_ASSETS_H
+#define OSJ_ASSETS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief 빌드할 때 gzip으로 압축해 둔 정적 파일 하나.
+ */
+typedef struct {
+	const char *uri;		   ///< index.html은 "/", 나머지는 "/파일명"
+	const char *type;		   ///< Content-Type
+	const char *cache_control; ///< Cache-Control 값
+	const char *etag;		   ///< 따옴표를 포함한 strong ETag
+	const uint8_t *data;	   ///< gzip 데이터
+	uint32_t len;			   ///< gzip 데이터 길이
+	uint32_t raw_len;		   ///< 압축 전 길이
+} osj_asset_t;
+
+/**
+ * @brief html/의 정적 파일 목록 (gen_assets.py가 생성).
+ * @details ETag는 gzip 데이터의 SHA-256에서 만든다. HTML은 매번
+ * If-None-Match로 재검증하고, HTML이 참조하는 파일은 "?v=태그"가 붙은
+ * 주소로 바뀌어 오래 캐시된다.
+ */
+extern const osj_asset_t osj_assets[];
+extern const size_t osj_asset_count;
+
+#endif
@@ -4,193 +4,290 @@
 #include "esp_log.h"
 #include "esp_system.h"
 #include "gpio_definitions.h"
+#include "osj_boot.h"
 #include "osj_gpio.h"
 #include "osj_nvs.h"
-#include "osj_sensor.h"
 #include "osj_wifi.h"
 #include "osj_websocket.h"
 #include "esp_ota_ops.h"
 #include "esp_partition.h"
 #include "esp_timer.h"
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 static const char *TAG = "OSJ_HTTP";
 static httpd_handle_t server = NULL;
 
+#include "osj_api.h"
+#include "osj_assets.h"
+#include "osj_live.h"
 #include "osj_config.h"
-
-extern const char index_html_start[] asm("_binary_index_html_start");
-extern const char index_html_end[] asm("_binary_index_html_end");
+#include "osj_template.h"
 
 #include "laundry_core.h"
 
-static esp_err_t send_chunk(httpd_req_t *req, const char *str) {
-	return httpd_resp_send_chunk(req, str, strlen(str));
+typedef struct {
+	SystemConfig cfg;
+	laundry_status_t status;
+	char ip[16];
+	char mac[18];
+	int8_t rssi;
+} page_ctx_t;
+
+typedef esp_err_t (*page_write_fn)(void *arg, const char *data, size_t len);
+
+static void page_ctx_load(page_ctx_t *ctx) {
+	osj_wifi_get_ip(ctx->ip);
+	osj_wifi_get_mac(ctx->mac);
+	ctx->rssi = osj_wifi_get_rssi();
+	// Readings come from the core loop's last pass; sampling the ADC here
+	// would stall the server task.
+	laundry_core_get_status(&ctx->status);
+
+	const SystemConfig *cur = osj_config_acquire();
+	ctx->cfg = *cur;
+	osj_config_release(cur);
 }
 
-static esp_err_t root_get_handler(httpd_req_t *req) {
-	char ssid[32], ip[16], mac[18], room[16];
-	char ch1Dev[8], ch2Dev[8];
-	float ch1CW, ch2CW, ch1CD, ch2CD;
-	uint32_t ch1FW, ch2FW;
-	uint32_t ch1EDW, ch2EDW, ch1EDD, ch2EDD;
-	bool isCh1Live, isCh2Live;
-	char temp_val[64];
-
-	osj_wifi_get_ip(ip);
-	osj_wifi_get_mac(mac);
-	int8_t rssi = osj_wifi_get_rssi();
-
-    osj_config_lock();
-	strncpy(ssid, sys_config.apSsid, sizeof(ssid));
-	strncpy(room, sys_config.roomNo, sizeof(room));
-	
-	strncpy(ch1Dev, sys_config.ch1DeviceNo, sizeof(ch1Dev));
-	strncpy(ch2Dev, sys_config.ch2DeviceNo, sizeof(ch2Dev));
-
-	ch1CW = sys_config.ch1CurrW;
-	ch2CW = sys_config.ch2CurrW;
-	ch1FW = sys_config.ch1FlowW;
-	ch2FW = sys_config.ch2FlowW;
-	ch1CD = sys_config.ch1CurrD;
-	ch2CD = sys_config.ch2CurrD;
-	ch1EDW = sys_config.ch1EndDelayW;
-	ch2EDW = sys_config.ch2EndDelayW;
-	ch1EDD = sys_config.ch1EndDelayD;
-	ch2EDD = sys_config.ch2EndDelayD;
-	isCh1Live = sys_config.isCh1Live;
-	isCh2Live = sys_config.isCh2Live;
-    osj_config_unlock();
-
-	const char *ptr = index_html_start;
-	const char *end = index_html_end;
-	
-	while (ptr < end) {
-	    const char *token_start = strchr(ptr, '%');
-	    
-	    if (token_start == NULL || token_start >= end) {
-	        httpd_resp_send_chunk(req, ptr, end - ptr);
-	        break;
-	    }
-	    
-	    if (token_start > ptr) {
-	        httpd_resp_send_chunk(req, ptr, token_start - ptr);
-	    }
-	    
-	    const char *token_end = strchr(token_start + 1, '%');
-	    if (token_end == NULL || token_end >= end) {
-	        httpd_resp_send_chunk(req, token_start, end - token_start);
-	        break;
-	    }
-	    
-	    int token_len = token_end - token_start - 1;
-	    if (token_len <= 0) {
-            send_chunk(req, "%");
-            ptr = token_end + 1;
-            continue;
-	    }
-
-        bool matched = false;
-        
-        #define IS_TOKEN(s) (strncmp(token_start + 1, s, token_len) == 0 && strlen(s) == token_len)
-        
-        if (IS_TOKEN("deviceName")) {
-            send_chunk(req, "OSJ Device"); matched = true;
-        } else if (IS_TOKEN("apSsid")) {
-            send_chunk(req, ssid); matched = true;
-        } else if (IS_TOKEN("wifiRssi")) {
-            snprintf(temp_val, sizeof(temp_val), "%d", rssi);
-            send_chunk(req, temp_val); matched = true;
-        } else if (IS_TOKEN("wifiQuality")) {
-            send_chunk(req, (rssi > -50) ? "Good" : "Weak"); matched = true;
-        } else if (IS_TOKEN("wifiIp")) {
-            send_chunk(req, ip); matched = true;
-        } else if (IS_TOKEN("mac")) {
-            send_chunk(req, mac); matched = true;
-        } else if (IS_TOKEN("roomNo")) {
-            send_chunk(req, room); matched = true;
-        } else if (IS_TOKEN("heap")) {
-            snprintf(temp_val, sizeof(temp_val), "%lu", esp_get_free_heap_size() / 1024);
-            send_chunk(req, temp_val); matched = true;
-        } else if (IS_TOKEN("ch1DeviceNo")) {
-            send_chunk(req, ch1Dev); matched = true;
-        } else if (IS_TOKEN("isCh1Live")) {
-            send_chunk(req, isCh1Live ? "Yes" : "No"); matched = true;
-        } else if (IS_TOKEN("ch1Mode")) {
-            send_chunk(req, !FAST_GPIO_READ(PIN_CH1_MODE) ? "Wash" : "Dry"); matched = true;
-        } else if (IS_TOKEN("ch1CurrW")) {
-            snprintf(temp_val, sizeof(temp_val), "%.2f", ch1CW);
-            send_chunk(req, temp_val); matched = true;
-        } else if (IS_TOKEN("ch1FlowW")) {
-            snprintf(temp_val, sizeof(temp_val), "%lu", ch1FW);
-            send_chunk(req, temp_val); matched = true;
-        } else if (IS_TOKEN("ch1CurrD")) {
-            snprintf(temp_val, sizeof(temp_val), "%.2f", ch1CD);
-            send_chunk(req, temp_val); matched = true;
-        } else if (IS_TOKEN("ch1EndDelayW")) {
-            snprintf(temp_val, sizeof(temp_val), "%lu", ch1EDW);
-            send_chunk(req, temp_val); matched = true;
-        } else if (IS_TOKEN("ch1EndDelayD")) {
-            snprintf(temp_val, sizeof(temp_val), "%lu", ch1EDD);
-            send_chunk(req, temp_val); matched = true;
-        } else if (IS_TOKEN("ampsTrms1")) {
-            snprintf(temp_val, sizeof(temp_val), "%.2f", osj_sensor_get_rms(1));
-            send_chunk(req, temp_val); matched = true;
-        } else if (IS_TOKEN("waterSensorData1")) {
-            snprintf(temp_val, sizeof(temp_val), "%d", osj_sensor_get_drain(1));
-            send_chunk(req, temp_val); matched = true;
-        } else if (IS_TOKEN("lHour1")) {
-            snprintf(temp_val, sizeof(temp_val), "%lu", laundry_core_get_lHour(1));
-            send_chunk(req, temp_val); matched = true;
-        }
-        else if (IS_TOKEN("ch2DeviceNo")) {
-            send_chunk(req, ch2Dev); matched = true;
-        } else if (IS_TOKEN("isCh2Live")) {
-            send_chunk(req, isCh2Live ? "Yes" : "No"); matched = true;
-        } else if (IS_TOKEN("ch2Mode")) {
-            send_chunk(req, !FAST_GPIO_READ(PIN_CH2_MODE) ? "Wash" : "Dry"); matched = true;
-        } else if (IS_TOKEN("ch2CurrW")) {
-            snprintf(temp_val, sizeof(temp_val), "%.2f", ch2CW);
-            send_chunk(req, temp_val); matched = true;
-        } else if (IS_TOKEN("ch2FlowW")) {
-            snprintf(temp_val, sizeof(temp_val), "%lu", ch2FW);
-            send_chunk(req, temp_val); matched = true;
-        } else if (IS_TOKEN("ch2CurrD")) {
-            snprintf(temp_val, sizeof(temp_val), "%.2f", ch2CD);
-            send_chunk(req, temp_val); matched = true;
-        } else if (IS_TOKEN("ch2EndDelayW")) {
-            snprintf(temp_val, sizeof(temp_val), "%lu", ch2EDW);
-            send_chunk(req, temp_val); matched = true;
-        } else if (IS_TOKEN("ch2EndDelayD")) {
-            snprintf(temp_val, sizeof(temp_val), "%lu", ch2EDD);
-            send_chunk(req, temp_val); matched = true;
-        } else if (IS_TOKEN("ampsTrms2")) {
-            snprintf(temp_val, sizeof(temp_val), "%.2f", osj_sensor_get_rms(2));
-            send_chunk(req, temp_val); matched = true;
-        } else if (IS_TOKEN("waterSensorData2")) {
-            snprintf(temp_val, sizeof(temp_val), "%d", osj_sensor_get_drain(2));
-            send_chunk(req, temp_val); matched = true;
-        } else if (IS_TOKEN("lHour2")) {
-            snprintf(temp_val, sizeof(temp_val), "%lu", laundry_core_get_lHour(2));
-            send_chunk(req, temp_val); matched = true;
-        } else if (IS_TOKEN("flashSize")) {
-            send_chunk(req, "4096"); matched = true;
-        } else if (IS_TOKEN("buildVer")) {
-            send_chunk(req, "v1.0"); matched = true;
-        }
+// Returns either a constant or buf.
+static const char *render_field(const page_ctx_t *ctx, uint16_t field,
+								char *buf, size_t len) {
+	switch (field) {
+	case OSJ_TPL_F_deviceName:
+		return "OSJ Device";
+	case OSJ_TPL_F_wifiRssi:
+		snprintf(buf, len, "%d", ctx->rssi);
+		return buf;
+	case OSJ_TPL_F_wifiQuality:
+		return (ctx->rssi > -50) ? "Good" : "Weak";
+	case OSJ_TPL_F_wifiIp:
+		return ctx->ip;
+	case OSJ_TPL_F_mac:
+		return ctx->mac;
+	case OSJ_TPL_F_heap:
+		snprintf(buf, len, "%lu", esp_get_free_heap_size() / 1024);
+		return buf;
+	case OSJ_TPL_F_ch1Mode:
+		return !FAST_GPIO_READ(PIN_CH1_MODE) ? "Wash" : "Dry";
+	case OSJ_TPL_F_ampsTrms1:
+		snprintf(buf, len, "%.2f", ctx->status.ch[0].amps);
+		return buf;
+	case OSJ_TPL_F_waterSensorData1:
+		snprintf(buf, len, "%d", ctx->status.ch[0].drain);
+		return buf;
+	case OSJ_TPL_F_lHour1:
+		snprintf(buf, len, "%lu", ctx->status.ch[0].lHour);
+		return buf;
+	case OSJ_TPL_F_ch2Mode:
+		return !FAST_GPIO_READ(PIN_CH2_MODE) ? "Wash" : "Dry";
+	case OSJ_TPL_F_ampsTrms2:
+		snprintf(buf, len, "%.2f", ctx->status.ch[1].amps);
+		return buf;
+	case OSJ_TPL_F_waterSensorData2:
+		snprintf(buf, len, "%d", ctx->status.ch[1].drain);
+		return buf;
+	case OSJ_TPL_F_lHour2:
+		snprintf(buf, len, "%lu", ctx->status.ch[1].lHour);
+		return buf;
+	case OSJ_TPL_F_flashSize:
+		return "4096";
+	case OSJ_TPL_F_buildVer:
+		return "v1.0";
+	case OSJ_TPL_F_bootTimes:
+		osj_boot_format(buf, len);
+		return buf;
+	case OSJ_TPL_F_flashWrites:
+		osj_nvs_format_stats(buf, len);
+		return buf;
+	}
 
-        if (!matched) {
-            httpd_resp_send_chunk(req, token_start, token_len + 2);
-        }
-        
-        ptr = token_end + 1;
+	// Config fields render straight from the registry.
+	const osj_config_field_t *f = osj_tpl_config_field(field);
+	if (!f)
+		return "";
+	if (f->type == OSJ_CFG_BOOL)
+		return *(const bool *)((const char *)&ctx->cfg + f->offset) ? "Yes"
+																	: "No";
+	osj_config_format(&ctx->cfg, f, buf, len);
+	return buf;
+}
+
+static esp_err_t render_page(const page_ctx_t *ctx, page_write_fn write,
+							 void *arg) {
+	char buf[256];
+	for (size_t i = 0; i < osj_page.count; i++) {
+		const osj_tpl_segment_t *seg = &osj_page.segs[i];
+		esp_err_t err;
+		if (seg->field == OSJ_TPL_LITERAL) {
+			err = write(arg, seg->text, seg->len);
+		} else {
+			const char *val = render_field(ctx, seg->field, buf, sizeof(buf));
+			err = write(arg, val, strlen(val));
+		}
+		if (err != ESP_OK)
+			return err;
+	}
+	return ESP_OK;
+}
+
+// Output is collected into chunks that fit one TCP segment together with
+// the chunk size line and CRLF, instead of one chunk per literal and value.
+#ifdef CONFIG_LWIP_TCP_MSS
+#define CHUNK_SIZE (CONFIG_LWIP_TCP_MSS - 16)
+#else
+#define CHUNK_SIZE 1420
+#endif
+
+typedef struct {
+	httpd_req_t *req; // NULL only counts, for the benchmark
+	size_t len;
+	size_t bytes;
+	uint32_t chunks;
+	char buf[CHUNK_SIZE];
+} chunk_writer_t;
+
+static esp_err_t chunk_flush(chunk_writer_t *w) {
+	if (w->len == 0)
+		return ESP_OK;
+	esp_err_t err = ESP_OK;
+	if (w->req)
+		err = httpd_resp_send_chunk(w->req, w->buf, w->len);
+	w->bytes += w->len;
+	w->chunks++;
+	w->len = 0;
+	return err;
+}
+
+static esp_err_t chunk_write(void *arg, const char *data, size_t len) {
+	chunk_writer_t *w = arg;
+	while (len > 0) {
+		size_t n = CHUNK_SIZE - w->len;
+		if (n > len)
+			n = len;
+		memcpy(w->buf + w->len, data, n);
+		w->len += n;
+		data += n;
+		len -= n;
+		if (w->len == CHUNK_SIZE) {
+			esp_err_t err = chunk_flush(w);
+			if (err != ESP_OK)
+				return err;
+		}
 	}
-	
+	return ESP_OK;
+}
+
+// GET /info: the device values the cached page fetches on every load.
+static esp_err_t info_get_handler(httpd_req_t *req) {
+	page_ctx_t ctx;
+	page_ctx_load(&ctx);
+
+	httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+	chunk_writer_t w = {.req = req};
+
+	// A failed send means the client went away; ESP_FAIL closes the socket.
+	esp_err_t err = render_page(&ctx, chunk_write, &w);
+	if (err == ESP_OK)
+		err = chunk_flush(&w);
+	if (err != ESP_OK)
+		return ESP_FAIL;
 	httpd_resp_send_chunk(req, NULL, 0);
 	return ESP_OK;
 }
 
+// If-None-Match is a list of tags or "*". The tags are fixed-length hex, so
+// a substring match is exact and also accepts the weak W/ form.
+static bool etag_match(const char *list, const char *etag) {
+	return strcmp(list, "*") == 0 || strstr(list, etag) != NULL;
+}
+
+// Static files are stored gzipped and sent as-is; every browser that can
+// run the page's script accepts gzip.
+static esp_err_t asset_get_handler(httpd_req_t *req) {
+	const osj_asset_t *a = req->user_ctx;
+	char inm[128];
+
+	httpd_resp_set_hdr(req, "ETag", a->etag);
+	httpd_resp_set_hdr(req, "Cache-Control", a->cache_control);
+	// A header too long for inm comes back truncated and just gets a 200.
+	if (httpd_req_get_hdr_value_str(req, "If-None-Match", inm, sizeof(inm)) ==
+			ESP_OK &&
+		etag_match(inm, a->etag)) {
+		httpd_resp_set_status(req, "304 Not Modified");
+		return httpd_resp_send(req, NULL, 0);
+	}
+
+	httpd_resp_set_type(req, a->type);
+	httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+	httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+	return httpd_resp_send(req, (const char *)a->data, a->len);
+}
+
+#if CONFIG_OSJ_HTTP_RENDER_BENCH
+// Counts the chunks the page took before writes were coalesced: one per
+// non-empty literal or value.
+static esp_err_t write_tally(void *arg, const char *data, size_t len) {
+	if (len > 0)
+		(*(uint32_t *)arg)++;
+	return ESP_OK;
+}
+
+// GET /bench/render?n=N renders the page N times through a chunk writer
+// that counts instead of sending, which isolates template, formatting and
+// copy cost from the socket.
+static esp_err_t bench_render_handler(httpd_req_t *req) {
+	char query[32], val[12];
+	int n = 100;
+	if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+		httpd_query_key_value(query, "n", val, sizeof(val)) == ESP_OK)
+		n = atoi(val);
+	if (n < 1 || n > 10000)
+		n = 100;
+
+	page_ctx_t ctx;
+	page_ctx_load(&ctx);
+
+	uint32_t unbuffered = 0;
+	render_page(&ctx, write_tally, &unbuffered);
+
+	chunk_writer_t w = {.req = NULL};
+	int64_t worst = 0;
+	int64_t t0 = esp_timer_get_time();
+	for (int i = 0; i < n; i++) {
+		int64_t r0 = esp_timer_get_time();
+		render_page(&ctx, chunk_write, &w);
+		chunk_flush(&w);
+		int64_t took = esp_timer_get_time() - r0;
+		if (took > worst)
+			worst = took;
+	}
+	int64_t total = esp_timer_get_time() - t0;
+	size_t bytes = w.bytes;
+
+	cJSON *root = cJSON_CreateObject();
+	cJSON_AddNumberToObject(root, "renders", n);
+	cJSON_AddNumberToObject(root, "segments", osj_page.count);
+	cJSON_AddNumberToObject(root, "literalBytes", osj_page.literal_bytes);
+	cJSON_AddNumberToObject(root, "pageBytes", bytes / n);
+	cJSON_AddNumberToObject(root, "chunkSize", CHUNK_SIZE);
+	cJSON_AddNumberToObject(root, "chunksUnbuffered", unbuffered);
+	cJSON_AddNumberToObject(root, "chunks", w.chunks / n);
+	cJSON_AddNumberToObject(root, "avgUs", (double)total / n);
+	cJSON_AddNumberToObject(root, "maxUs", worst);
+	cJSON_AddNumberToObject(root, "bytesPerS",
+							total > 0 ? bytes * 1e6 / total : 0);
+	char *json = cJSON_PrintUnformatted(root);
+	cJSON_Delete(root);
+	if (!json)
+		return httpd_resp_send_500(req);
+	httpd_resp_set_type(req, "application/json");
+	httpd_resp_send(req, json, HTTPD_RESP_USE_STRLEN);
+	free(json);
+	return ESP_OK;
+}
+#endif
+
 static esp_err_t wifi_post_handler(httpd_req_t *req) {
 	char buf[100];
 	int ret, remaining = req->content_len;
@@ -209,19 +306,28 @@ static esp_err_t wifi_post_handler(httpd_req_t *req) {
 	char *ssid_ptr = strstr(buf, "wifiSsid=");
 	char *pass_ptr = strstr(buf, "wifiPass=");
 
+	// SSID and password are stored together so a reboot never sees one
+	// without the other.
+	osj_config_txn_t txn;
+	osj_config_begin(&txn);
 	if (ssid_ptr) {
 		ssid_ptr += 9;
 		char *end = strchr(ssid_ptr, '&');
 		if (end)
 			*end = '\0';
-		osj_nvs_set_str("apSsid", ssid_ptr);
+		osj_config_set_str(&txn, "apSsid", ssid_ptr);
 	}
 	if (pass_ptr) {
 		pass_ptr += 9;
 		char *end = strchr(pass_ptr, '&');
 		if (end)
 			*end = '\0';
-		osj_nvs_set_str("apPasswd", pass_ptr);
+		osj_config_set_str(&txn, "apPasswd", pass_ptr);
+	}
+	if (osj_config_commit(&txn) != ESP_OK) {
+		httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST,
+								"Invalid Wi-Fi settings");
+		return ESP_FAIL;
 	}
 
 	httpd_resp_set_status(req, "303 See Other");
@@ -248,7 +354,14 @@ static esp_err_t room_post_handler(httpd_req_t *req) {
 		char *end = strchr(room_ptr, '&');
 		if (end)
 			*end = '\0';
-		osj_nvs_set_str("roomNo", room_ptr);
+		osj_config_txn_t txn;
+		osj_config_begin(&txn);
+		osj_config_set_str(&txn, "roomNo", room_ptr);
+		if (osj_config_commit(&txn) != ESP_OK) {
+			httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST,
+									"Invalid room number");
+			return ESP_FAIL;
+		}
 	}
 
 	httpd_resp_set_status(req, "303 See Other");
@@ -295,10 +408,18 @@ static esp_err_t ch1_post_handler(httpd_req_t *req) {
 			*end = '\0';
 
 		ESP_LOGI(TAG, "Updating CH1 Device ID to: %s", id_ptr);
-		osj_nvs_set_str("ch1DeviceNo", id_ptr);
+		osj_config_txn_t txn;
+		osj_config_begin(&txn);
+		osj_config_set_str(&txn, "ch1DeviceNo", id_ptr);
+		if (osj_config_commit(&txn) != ESP_OK) {
+			httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST,
+									"Invalid device number");
+			return ESP_FAIL;
+		}
 		
 		last_update_time = esp_timer_get_time();
-		osj_websocket_restart();
+		uint32_t ticket = osj_websocket_restart();
+		ESP_LOGI(TAG, "WebSocket restart #%lu queued", ticket);
 	}
 
 	httpd_resp_set_status(req, "303 See Other");
@@ -389,14 +510,26 @@ static esp_err_t set_default_val_handler(httpd_req_t *req) {
 void osj_http_start_server(void) {
 	httpd_config_t config = HTTPD_DEFAULT_CONFIG();
 	config.stack_size = 8192;
-	config.max_uri_handlers = 10;
+	config.max_uri_handlers = 20;
+	config.uri_match_fn = httpd_uri_match_wildcard;
 
 	if (httpd_start(&server, &config) == ESP_OK) {
-		httpd_uri_t root_uri = {.uri = "/",
+		for (size_t i = 0; i < osj_asset_count; i++) {
+			httpd_uri_t asset_uri = {.uri = osj_assets[i].uri,
+									 .method = HTTP_GET,
+									 .handler = asset_get_handler,
+									 .user_ctx = (void *)&osj_assets[i]};
+			httpd_register_uri_handler(server, &asset_uri);
+		}
+
+		httpd_uri_t info_uri = {.uri = "/info",
 								.method = HTTP_GET,
-								.handler = root_get_handler,
+								.handler = info_get_handler,
 								.user_ctx = NULL};
-		httpd_register_uri_handler(server, &root_uri);
+		httpd_register_uri_handler(server, &info_uri);
+
+		osj_api_register(server);
+		osj_live_register(server);
 
 		httpd_uri_t wifi_uri = {.uri = "/wifi",
 								.method = HTTP_POST,
@@ -440,6 +573,14 @@ void osj_http_start_server(void) {
 								   .user_ctx = NULL};
 		httpd_register_uri_handler(server, &default_uri);
 
+#if CONFIG_OSJ_HTTP_RENDER_BENCH
+		httpd_uri_t bench_uri = {.uri = "/bench/render",
+								 .method = HTTP_GET,
+								 .handler = bench_render_handler,
+								 .user_ctx = NULL};
+		httpd_register_uri_handler(server, &bench_uri);
+#endif
+
 		ESP_LOGI(TAG, "HTTP Server Started");
 	}
 }
\ No newline at end of file
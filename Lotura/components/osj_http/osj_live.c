@@ -0,0 +1,228 @@
+#include "osj_live.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "laundry_core.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if CONFIG_OSJ_HTTP_LIVE
+
+static const char *TAG = "OSJ_LIVE";
+
+#define LIVE_DEFAULT_HZ 2
+#define MAX_VIEWERS CONFIG_OSJ_HTTP_LIVE_MAX_VIEWERS
+
+typedef struct {
+	int fd; // -1 when free
+	uint32_t period_ms;
+	int64_t next_ms;
+	uint32_t last_seq;
+} live_viewer_t;
+
+// The table and the frame are only touched on the server task: by the
+// websocket handler and by live_send(), which the ticker queues there. The
+// ticker only reads the viewer count.
+static httpd_handle_t live_server = NULL;
+static live_viewer_t viewers[MAX_VIEWERS];
+static volatile int viewer_count = 0;
+static volatile bool send_queued = false;
+static TaskHandle_t ticker = NULL;
+static char frame[256];
+
+static int64_t millis(void) { return esp_timer_get_time() / 1000; }
+
+static uint32_t period_for(long hz) {
+	if (hz < 1)
+		hz = 1;
+	if (hz > CONFIG_OSJ_HTTP_LIVE_MAX_HZ)
+		hz = CONFIG_OSJ_HTTP_LIVE_MAX_HZ;
+	return 1000 / hz;
+}
+
+static live_viewer_t *viewer_find(int fd) {
+	for (int i = 0; i < MAX_VIEWERS; i++)
+		if (viewers[i].fd == fd)
+			return &viewers[i];
+	return NULL;
+}
+
+static void viewer_drop(live_viewer_t *v) {
+	ESP_LOGI(TAG, "Viewer on socket %d left", v->fd);
+	v->fd = -1;
+	viewer_count--;
+}
+
+// Session context free function: the server calls it when the socket
+// closes for any reason, so a viewer that leaves frees its slot at once
+// instead of at the next send. The context holds the socket number because
+// the slot may already belong to someone else by then.
+static void viewer_closed(void *ctx) {
+	live_viewer_t *v = viewer_find(*(int *)ctx);
+	if (v)
+		viewer_drop(v);
+	free(ctx);
+}
+
+static int format_frame(const laundry_status_t *st) {
+	int n = snprintf(frame, sizeof(frame), "{\"seq\":%lu,\"atMs\":%lld,\"ch\":[",
+					 st->seq, st->at_ms);
+	for (int i = 0; i < 2; i++) {
+		const laundry_channel_status_t *c = &st->ch[i];
+		n += snprintf(frame + n, sizeof(frame) - n,
+					  "%s{\"amps\":%.3f,\"lHour\":%lu,\"drain\":%d,"
+					  "\"running\":%s}",
+					  i ? "," : "", c->amps, c->lHour, c->drain,
+					  c->running ? "true" : "false");
+	}
+	n += snprintf(frame + n, sizeof(frame) - n, "]}");
+	return n;
+}
+
+// Runs on the server task. Every due viewer gets the same frame, built once
+// from the core loop's last snapshot; a viewer that already has this seq
+// waits for the next one.
+static void live_send(void *arg) {
+	send_queued = false;
+	int64_t now = millis();
+	laundry_status_t st;
+	int len = -1;
+
+	for (int i = 0; i < MAX_VIEWERS; i++) {
+		live_viewer_t *v = &viewers[i];
+		if (v->fd < 0 || now < v->next_ms)
+			continue;
+		if (httpd_ws_get_fd_info(live_server, v->fd) !=
+			HTTPD_WS_CLIENT_WEBSOCKET) {
+			viewer_drop(v);
+			continue;
+		}
+		if (len < 0) {
+			laundry_core_get_status(&st);
+			len = format_frame(&st);
+		}
+		if (st.seq == v->last_seq)
+			continue;
+
+		httpd_ws_frame_t ws = {
+			.type = HTTPD_WS_TYPE_TEXT,
+			.payload = (uint8_t *)frame,
+			.len = len,
+			.final = true,
+		};
+		if (httpd_ws_send_frame_async(live_server, v->fd, &ws) != ESP_OK) {
+			viewer_drop(v);
+			continue;
+		}
+		v->last_seq = st.seq;
+		v->next_ms += v->period_ms;
+		// A viewer that fell behind restarts from now instead of bursting.
+		if (v->next_ms < now)
+			v->next_ms = now + v->period_ms;
+	}
+}
+
+// Wakes at twice the highest rate while someone is watching and hands the
+// work to the server task, which owns the sockets. Sleeps until the first
+// viewer otherwise.
+static void live_ticker(void *arg) {
+	TickType_t tick = pdMS_TO_TICKS(500 / CONFIG_OSJ_HTTP_LIVE_MAX_HZ);
+	if (tick == 0)
+		tick = 1;
+	for (;;) {
+		if (viewer_count == 0)
+			ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		if (!send_queued) {
+			send_queued = true;
+			if (httpd_queue_work(live_server, live_send, NULL) != ESP_OK)
+				send_queued = false;
+		}
+		vTaskDelay(tick);
+	}
+}
+
+// Accepts "5", "hz=5" and {"hz":5}.
+static long parse_hz(const char *s) {
+	while (*s && (*s < '0' || *s > '9'))
+		s++;
+	return *s ? strtol(s, NULL, 10) : LIVE_DEFAULT_HZ;
+}
+
+static esp_err_t live_ws_handler(httpd_req_t *req) {
+	int fd = httpd_req_to_sockfd(req);
+
+	if (req->method == HTTP_GET) {
+		char query[24], val[8];
+		long hz = LIVE_DEFAULT_HZ;
+		if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+			httpd_query_key_value(query, "hz", val, sizeof(val)) == ESP_OK)
+			hz = parse_hz(val);
+
+		live_viewer_t *v = viewer_find(fd);
+		if (!v)
+			v = viewer_find(-1);
+		if (!v) {
+			ESP_LOGW(TAG, "Viewer limit reached, closing socket %d", fd);
+			return ESP_FAIL;
+		}
+		if (!req->sess_ctx) {
+			int *ctx = malloc(sizeof(int));
+			if (!ctx)
+				return ESP_ERR_NO_MEM;
+			*ctx = fd;
+			req->sess_ctx = ctx;
+			req->free_ctx = viewer_closed;
+		}
+		if (v->fd == fd)
+			viewer_count--;
+		*v = (live_viewer_t){.fd = fd,
+							 .period_ms = period_for(hz),
+							 .next_ms = millis()};
+		viewer_count++;
+		ESP_LOGI(TAG, "Viewer on socket %d at %lu ms", fd, v->period_ms);
+		xTaskNotifyGive(ticker);
+		return ESP_OK;
+	}
+
+	// The server answers ping and close itself; text frames set the rate.
+	char buf[24];
+	httpd_ws_frame_t ws = {.payload = (uint8_t *)buf};
+	esp_err_t err = httpd_ws_recv_frame(req, &ws, 0);
+	if (err != ESP_OK || ws.len >= sizeof(buf))
+		return ESP_FAIL;
+	err = httpd_ws_recv_frame(req, &ws, ws.len);
+	if (err != ESP_OK)
+		return err;
+	buf[ws.len] = '\0';
+
+	live_viewer_t *v = viewer_find(fd);
+	if (v && ws.type == HTTPD_WS_TYPE_TEXT) {
+		v->period_ms = period_for(parse_hz(buf));
+		v->next_ms = millis();
+	}
+	return ESP_OK;
+}
+
+void osj_live_register(httpd_handle_t server) {
+	live_server = server;
+	for (int i = 0; i < MAX_VIEWERS; i++)
+		viewers[i].fd = -1;
+	if (!ticker)
+		xTaskCreate(live_ticker, "live_tick", 2048, NULL, 4, &ticker);
+
+	httpd_uri_t live_uri = {.uri = "/ws/live",
+							.method = HTTP_GET,
+							.handler = live_ws_handler,
+							.user_ctx = NULL,
+							.is_websocket = true};
+	httpd_register_uri_handler(server, &live_uri);
+}
+
+#else
+
+void osj_live_register(httpd_handle_t server) {}
+
+#endif
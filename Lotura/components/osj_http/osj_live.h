@@ -0,0 +1,18 @@
+#ifndef OSJ_LIVE_H
+#define OSJ_LIVE_H
+
+#include "esp_http_server.h"
+
+/** @brief osj_live_register()가 등록하는 URI 핸들러 수 */
+#define OSJ_LIVE_URI_COUNT 1
+
+/**
+ * @brief 실시간 측정값 웹소켓(/ws/live)을 등록하고 전송 태스크를 만든다.
+ * @details 보는 쪽마다 주기를 따로 두지만 프레임은 틱마다 한 번만
+ * 만들며, 값은 laundry_core_get_status()의 스냅샷에서 가져온다.
+ * 소켓이 닫히면 세션 컨텍스트 해제 콜백에서 바로 자리를 비운다.
+ * CONFIG_OSJ_HTTP_LIVE가 꺼져 있으면 아무것도 하지 않는다.
+ */
+void osj_live_register(httpd_handle_t server);
+
+#endif
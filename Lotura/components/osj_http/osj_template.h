@@ -0,0 +1,85 @@
+#ifndef OSJ_TEMPLATE_H
+#define OSJ_TEMPLATE_H
+
+#include "osj_config.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief 설정 레지스트리 밖에서 값을 채우는 페이지 토큰 목록.
+ * @details 설정 필드 토큰(%roomNo% 등)은 OSJ_CONFIG_FIELDS에서 따로
+ * 만들어진다.
+ */
+#define OSJ_TPL_PAGE_FIELDS(X)                                                 \
+	X(deviceName)                                                              \
+	X(wifiRssi)                                                                \
+	X(wifiQuality)                                                             \
+	X(wifiIp)                                                                  \
+	X(mac)                                                                     \
+	X(heap)                                                                    \
+	X(ch1Mode)                                                                 \
+	X(ampsTrms1)                                                               \
+	X(waterSensorData1)                                                        \
+	X(lHour1)                                                                  \
+	X(ch2Mode)                                                                 \
+	X(ampsTrms2)                                                               \
+	X(waterSensorData2)                                                        \
+	X(lHour2)                                                                  \
+	X(flashSize)                                                               \
+	X(buildVer)                                                                \
+	X(bootTimes)                                                               \
+	X(flashWrites)
+
+#define OSJ_TPL_ID_PAGE(name) OSJ_TPL_F_##name,
+#define OSJ_TPL_ID_STR(name, len, def, flags) OSJ_TPL_F_##name,
+#define OSJ_TPL_ID_NUM(name, def, lo, hi, flags) OSJ_TPL_F_##name,
+#define OSJ_TPL_ID_BOOL(name, def, flags) OSJ_TPL_F_##name,
+
+/**
+ * @brief 세그먼트가 채울 값. 설정 필드는 레지스트리 순서대로
+ * OSJ_TPL_CONFIG_BASE 다음부터 번호가 매겨진다.
+ */
+typedef enum {
+	OSJ_TPL_LITERAL = 0,
+	OSJ_TPL_PAGE_FIELDS(OSJ_TPL_ID_PAGE)
+	OSJ_TPL_CONFIG_BASE,
+	OSJ_CONFIG_FIELDS(OSJ_TPL_ID_STR, OSJ_TPL_ID_NUM, OSJ_TPL_ID_NUM,
+					  OSJ_TPL_ID_BOOL)
+	OSJ_TPL_FIELD_COUNT
+} osj_tpl_field_t;
+
+/**
+ * @brief 템플릿 조각. field가 OSJ_TPL_LITERAL이면 text/len을 그대로
+ * 보내고, 아니면 해당 값을 채운다.
+ */
+typedef struct {
+	const char *text;
+	uint32_t len;
+	uint16_t field;
+} osj_tpl_segment_t;
+
+typedef struct {
+	const osj_tpl_segment_t *segs;
+	size_t count;
+	size_t literal_bytes; ///< 리터럴 조각 길이의 합
+} osj_tpl_t;
+
+/**
+ * @brief html/info.html을 빌드할 때 나눈 조각 목록 (gen_page.py가 생성).
+ * @details %이름%은 OSJ_TPL_PAGE_FIELDS나 비밀이 아닌 설정 필드여야 하며,
+ * 모르는 토큰이 있으면 빌드가 실패한다. 이름과 닫는 %가 따르지 않는 %는
+ * 글자 그대로이고, %%는 % 한 글자가 된다.
+ */
+extern const osj_tpl_t osj_page;
+
+/**
+ * @brief 필드 번호에 해당하는 설정 필드를 반환한다.
+ * @return 설정 필드, 설정 필드 번호가 아니면 NULL
+ */
+static inline const osj_config_field_t *osj_tpl_config_field(uint16_t field) {
+	if (field <= OSJ_TPL_CONFIG_BASE || field >= OSJ_TPL_FIELD_COUNT)
+		return NULL;
+	return osj_config_field_at(field - OSJ_TPL_CONFIG_BASE - 1);
+}
+
+#endif
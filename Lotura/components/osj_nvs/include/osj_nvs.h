@@ -1,17 +1,28 @@
 #ifndef OSJ_NVS_H
 #define OSJ_NVS_H
 
+#include "esp_err.h"
+#include "osj_config.h"
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
 /**
- * @brief NVS 파티션을 초기화한다.
+ * @brief NVS 파티션을 초기화하고 설정 레코드를 읽어 첫 설정으로 공개한다.
+ * @details 설정은 버전과 CRC가 붙은 하나의 blob("sysConfig")으로 저장되며
+ * 한 번의 읽기로 불러온다. blob이 없으면 이전의 키별 저장값을 읽어 blob으로
+ * 옮긴다. 이전 키는 롤백에 대비해 지우지 않는다. blob이 있지만 CRC 등이
+ * 맞지 않으면 이전 키로 되돌리지 않고 기본값으로 시작하며 오류를 남긴다.
+ * 미뤄진 설정을 기록하는 태스크와 재시작 시 기록하는 셧다운 핸들러도 여기서
+ * 등록한다.
  */
 void osj_nvs_init(void);
 
 /**
  * @brief 문자열 값을 NVS에 저장한다.
+ * @note SystemConfig 필드 이름과 같은 키는 한 필드짜리 트랜잭션으로
+ * 반영되어 osj_config_commit()처럼 기록이 미뤄진다. 다른 키는 개별 NVS
+ * 키로 바로 저장된다. 다른 setter와 getter도 같다.
  * @param key 저장할 키 이름
  * @param value 저장할 문자열 값
  */
@@ -72,4 +83,113 @@ void osj_nvs_set_bool(const char *key, bool value);
  */
 bool osj_nvs_get_bool(const char *key, bool default_value);
 
+/**
+ * @brief 바이너리 값을 개별 NVS 키로 바로 저장한다.
+ * @note 설정 레코드와 무관한 상태 저장용이다. 호출한 태스크에서 플래시를
+ * 쓰므로 빠른 루프에서는 부르지 않는다.
+ * @return ESP_OK 또는 NVS 오류 코드
+ */
+esp_err_t osj_nvs_set_blob(const char *key, const void *data, size_t len);
+
+/**
+ * @brief NVS에서 바이너리 값을 읽어온다.
+ * @param len 입력은 버퍼 크기, 출력은 읽은 크기
+ * @return ESP_OK, 없으면 ESP_ERR_NVS_NOT_FOUND, 버퍼가 작으면
+ * ESP_ERR_NVS_INVALID_LENGTH
+ */
+esp_err_t osj_nvs_get_blob(const char *key, void *data, size_t *len);
+
+/**
+ * @brief 설정 트랜잭션. osj_config_begin()으로 시작해 osj_config_commit()
+ * 또는 osj_config_abort()로 끝낸다.
+ */
+typedef struct {
+	SystemConfig next;	 ///< 적용할 설정 (begin 시점의 설정 사본)
+	esp_err_t err;		 ///< 처음 실패한 set/validate의 오류
+	const char *bad_key; ///< 처음 실패한 키
+} osj_config_txn_t;
+
+/**
+ * @brief 설정 트랜잭션을 시작한다.
+ * @details 다른 트랜잭션과 설정 저장은 commit/abort까지 대기하므로, 그
+ * 사이에는 오래 걸리는 일을 하지 않는다. 공개된 설정은 commit 전까지
+ * 바뀌지 않는다.
+ */
+void osj_config_begin(osj_config_txn_t *txn);
+
+/**
+ * @brief 트랜잭션 안에서 설정 필드 하나를 바꾼다.
+ * @details 키는 SystemConfig 필드 이름이다. 실패하면 트랜잭션에 오류가
+ * 남아 commit도 실패한다.
+ * @return ESP_OK, 없는 키면 ESP_ERR_NOT_FOUND, 문자열이 필드보다 길면
+ * ESP_ERR_INVALID_SIZE
+ */
+esp_err_t osj_config_set_str(osj_config_txn_t *txn, const char *key,
+							 const char *value);
+esp_err_t osj_config_set_float(osj_config_txn_t *txn, const char *key,
+							   float value);
+esp_err_t osj_config_set_uint(osj_config_txn_t *txn, const char *key,
+							  uint32_t value);
+esp_err_t osj_config_set_bool(osj_config_txn_t *txn, const char *key,
+							  bool value);
+
+/**
+ * @brief JSON 값 하나를 필드 종류에 맞춰 트랜잭션에 넣는다.
+ * @details 웹 API와 원격 SetConfig가 같은 규칙을 쓰도록 한 곳에 둔다.
+ * UINT 필드는 0 이상 UINT32_MAX 이하의 정수만 받는다. 범위 검사는 다른
+ * set과 마찬가지로 commit 때 한다.
+ * @return ESP_OK, 값의 종류가 필드와 맞지 않으면 ESP_ERR_INVALID_ARG,
+ * 또는 osj_config_set_*()의 오류
+ */
+esp_err_t osj_config_set_json(osj_config_txn_t *txn,
+							  const osj_config_field_t *f, const cJSON *v);
+
+/**
+ * @brief 트랜잭션의 설정 전체를 검사한다 (임계값·지연 범위 등).
+ * @return ESP_OK 또는 오류. 실패한 키는 txn->bad_key에 남는다.
+ */
+esp_err_t osj_config_validate(osj_config_txn_t *txn);
+
+/**
+ * @brief 검사 후 새 설정으로 한 번에 공개한다.
+ * @details 플래시 기록은 뒤로 미룬다. 마지막 commit 후
+ * CONFIG_OSJ_CONFIG_FLUSH_QUIET_MS 동안 변경이 없거나 esp_restart()가
+ * 호출되면 설정 레코드 blob을 한 번 쓴다 (값이 0이면 바로 쓴다). 바뀐
+ * 내용이 없으면 아무것도 하지 않는다. 검사에 실패하면 공개된 설정은
+ * 그대로 유지된다. 공개는 예비 버퍼를 빌린 독자가 있으면 그 독자가
+ * 돌려줄 때까지 기다린다. 성공 여부와 관계없이 트랜잭션은 끝난다.
+ * @return ESP_OK, 검사 오류, 또는 바로 쓰는 설정에서는 NVS 오류 코드
+ */
+esp_err_t osj_config_commit(osj_config_txn_t *txn);
+
+/**
+ * @brief 아무것도 반영하지 않고 트랜잭션을 끝낸다.
+ */
+void osj_config_abort(osj_config_txn_t *txn);
+
+/**
+ * @brief 아직 기록하지 않은 설정을 지금 NVS에 쓴다.
+ * @details 전원을 끄기 전처럼 조용한 시간을 기다릴 수 없을 때 쓴다.
+ * esp_restart()에서는 자동으로 호출된다.
+ * @return ESP_OK (기록할 것이 없을 때 포함) 또는 NVS 오류 코드
+ */
+esp_err_t osj_config_flush(void);
+
+/**
+ * @brief 플래시 기록 통계를 한 줄로 쓴다.
+ * @details 예: "12 record, 3 key writes, 1180/1512 free, pending"
+ * @return snprintf와 같은 반환값
+ */
+int osj_nvs_format_stats(char *buf, size_t len);
+
+/**
+ * @brief 플래시 기록 통계를 JSON으로 반환한다.
+ * @details {"pending":..,"commits":..,"flushes":..,"flushFailed":..,
+ * "recordWrites":..,"keyWrites":..,"usedEntries":..,"freeEntries":..,
+ * "totalEntries":..}. recordWrites는 기기 수명 동안의 설정 레코드 기록
+ * 횟수이고, 나머지 횟수는 부팅 후 값이다. 엔트리 수는 nvs_get_stats 결과다.
+ * @return cJSON 객체 (호출자가 cJSON_Delete 또는 다른 객체에 추가해야 함)
+ */
+cJSON *osj_nvs_get_stats_json(void);
+
 #endif
\ No newline at end of file
@@ -1,26 +1,360 @@
 #include "osj_nvs.h"
 #include "esp_log.h"
+#include "esp_rom_crc.h"
 #include "nvs.h"
 #include "nvs_flash.h"
+#include <inttypes.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_system.h"
 #include "osj_config.h"
+#include "osj_snapshot.h"
 
-SystemConfig sys_config;
-static SemaphoreHandle_t config_mutex = NULL;
+// Readers borrow one of the two copies without locking. Commits publish
+// into the other one.
+static SystemConfig config_slots[2];
+static osj_snapshot_t config_snap;
 
-void osj_config_lock(void) {
-    if (config_mutex) xSemaphoreTake(config_mutex, portMAX_DELAY);
+// Serializes transactions, i.e. every writer of the snapshot. Readers never
+// take it.
+static SemaphoreHandle_t save_mutex = NULL;
+
+// Commits only change RAM. The flush task writes the record once no commit
+// has arrived for FLUSH_QUIET_MS, so a burst of edits costs one flash write.
+// flush_mutex keeps the task and the shutdown handler from writing at once.
+#define FLUSH_QUIET_MS CONFIG_OSJ_CONFIG_FLUSH_QUIET_MS
+#define FLUSH_RETRY_MS (60 * 1000)
+static SemaphoreHandle_t flush_mutex = NULL;
+static TaskHandle_t flush_task_handle = NULL;
+static volatile uint32_t flushed_generation = 0;
+
+// Record writes over the device's life, kept next to the record.
+#define WRITES_KEY "cfgWrites"
+static uint32_t record_writes = 0;
+// Since boot.
+static uint32_t commit_count = 0;
+static uint32_t flush_count = 0;
+static uint32_t flush_failures = 0;
+static uint32_t raw_writes = 0;
+
+static const char *TAG = "OSJ_NVS";
+static const char *NAMESPACE = "storage";
+
+// SystemConfig is stored as one blob behind this header. Fields are only
+// ever appended: an older record leaves the new fields at their defaults,
+// and a newer one is read up to the fields this build knows.
+#define CONFIG_KEY "sysConfig"
+#define CONFIG_MAGIC 0x434a534f // "OSJC"
+#define CONFIG_VERSION 1
+
+typedef struct {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t size; // payload bytes following the header
+	uint32_t crc;  // esp_rom_crc32_le over the payload
+} config_header_t;
+
+typedef struct {
+	config_header_t hdr;
+	SystemConfig cfg;
+} config_record_t;
+
+#define CFG_FIELD_STR(name, len, def, flags)                                   \
+	{#name, OSJ_CFG_STR, offsetof(SystemConfig, name), len, 0, 0, flags},
+#define CFG_FIELD_FLOAT(name, def, lo, hi, flags)                              \
+	{#name, OSJ_CFG_FLOAT, offsetof(SystemConfig, name), sizeof(float), lo,    \
+	 hi, flags},
+#define CFG_FIELD_UINT(name, def, lo, hi, flags)                               \
+	{#name, OSJ_CFG_UINT, offsetof(SystemConfig, name), sizeof(uint32_t), lo, \
+	 hi, flags},
+#define CFG_FIELD_BOOL(name, def, flags)                                       \
+	{#name, OSJ_CFG_BOOL, offsetof(SystemConfig, name), sizeof(bool), 0, 1,   \
+	 flags},
+
+static const osj_config_field_t config_fields[] = {OSJ_CONFIG_FIELDS(
+	CFG_FIELD_STR, CFG_FIELD_FLOAT, CFG_FIELD_UINT, CFG_FIELD_BOOL)};
+#define CONFIG_FIELD_COUNT (sizeof(config_fields) / sizeof(config_fields[0]))
+
+// config_fields ordered by key, built once in osj_nvs_init().
+static const osj_config_field_t *config_sorted[CONFIG_FIELD_COUNT];
+
+#define CFG_DEFAULT_STR(name, len, def, flags)                                 \
+	strlcpy(c->name, def, sizeof(c->name));
+#define CFG_DEFAULT_NUM(name, def, lo, hi, flags) c->name = def;
+#define CFG_DEFAULT_BOOL(name, def, flags) c->name = def;
+
+static void config_defaults(SystemConfig *c) {
+	memset(c, 0, sizeof(*c));
+	OSJ_CONFIG_FIELDS(CFG_DEFAULT_STR, CFG_DEFAULT_NUM, CFG_DEFAULT_NUM,
+					  CFG_DEFAULT_BOOL)
 }
 
-void osj_config_unlock(void) {
-    if (config_mutex) xSemaphoreGive(config_mutex);
+static void config_index_build(void) {
+	for (size_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+		const osj_config_field_t *f = &config_fields[i];
+		size_t j = i;
+		while (j > 0 && strcmp(config_sorted[j - 1]->key, f->key) > 0) {
+			config_sorted[j] = config_sorted[j - 1];
+			j--;
+		}
+		config_sorted[j] = f;
+	}
 }
 
+const SystemConfig *osj_config_acquire(void) {
+	return osj_snapshot_acquire(&config_snap);
+}
 
-static const char *NAMESPACE = "storage";
+void osj_config_release(const SystemConfig *cfg) {
+	osj_snapshot_release(&config_snap, cfg);
+}
+
+uint32_t osj_config_generation(void) {
+	return osj_snapshot_version(&config_snap);
+}
+
+const osj_config_field_t *osj_config_find(const char *key, size_t len) {
+	size_t lo = 0, hi = CONFIG_FIELD_COUNT;
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+		const char *k = config_sorted[mid]->key;
+		int cmp = strncmp(k, key, len);
+		if (cmp == 0 && k[len] != '\0')
+			cmp = 1; // k is longer, so it sorts after key
+		if (cmp == 0)
+			return config_sorted[mid];
+		if (cmp < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return NULL;
+}
+
+size_t osj_config_field_count(void) { return CONFIG_FIELD_COUNT; }
+
+const osj_config_field_t *osj_config_field_at(size_t i) {
+	return i < CONFIG_FIELD_COUNT ? &config_fields[i] : NULL;
+}
+
+static void *field_ptr(SystemConfig *c, const osj_config_field_t *f) {
+	return (char *)c + f->offset;
+}
+
+static const void *field_cptr(const SystemConfig *c,
+							  const osj_config_field_t *f) {
+	return (const char *)c + f->offset;
+}
+
+int osj_config_format(const SystemConfig *cfg, const osj_config_field_t *f,
+					  char *buf, size_t len) {
+	const void *p = (const char *)cfg + f->offset;
+	switch (f->type) {
+	case OSJ_CFG_STR:
+		return snprintf(buf, len, "%s", (const char *)p);
+	case OSJ_CFG_FLOAT:
+		return snprintf(buf, len, "%.2f", *(const float *)p);
+	case OSJ_CFG_UINT:
+		return snprintf(buf, len, "%" PRIu32, *(const uint32_t *)p);
+	case OSJ_CFG_BOOL:
+		return snprintf(buf, len, "%s", *(const bool *)p ? "true" : "false");
+	}
+	return 0;
+}
+
+cJSON *osj_config_get_json(void) {
+	SystemConfig cfg;
+	const SystemConfig *cur = osj_config_acquire();
+	cfg = *cur;
+	osj_config_release(cur);
+
+	cJSON *obj = cJSON_CreateObject();
+	for (size_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+		const osj_config_field_t *f = &config_fields[i];
+		if (f->flags & OSJ_CFG_SECRET)
+			continue;
+		const void *p = field_cptr(&cfg, f);
+		switch (f->type) {
+		case OSJ_CFG_STR:
+			cJSON_AddStringToObject(obj, f->key, (const char *)p);
+			break;
+		case OSJ_CFG_FLOAT:
+			cJSON_AddNumberToObject(obj, f->key, *(const float *)p);
+			break;
+		case OSJ_CFG_UINT:
+			cJSON_AddNumberToObject(obj, f->key, *(const uint32_t *)p);
+			break;
+		case OSJ_CFG_BOOL:
+			cJSON_AddBoolToObject(obj, f->key, *(const bool *)p);
+			break;
+		}
+	}
+	return obj;
+}
+
+static void raw_get_str(nvs_handle_t h, const char *key, char *out,
+						size_t max_len) {
+	size_t required_size;
+	if (nvs_get_str(h, key, NULL, &required_size) == ESP_OK &&
+		required_size <= max_len)
+		nvs_get_str(h, key, out, &required_size);
+}
+
+static void raw_get_float(nvs_handle_t h, const char *key, float *out) {
+	float value;
+	size_t size = sizeof(float);
+	if (nvs_get_blob(h, key, &value, &size) == ESP_OK && size == sizeof(float))
+		*out = value;
+}
+
+static void raw_get_uint(nvs_handle_t h, const char *key, uint32_t *out) {
+	uint32_t value;
+	if (nvs_get_u32(h, key, &value) == ESP_OK)
+		*out = value;
+}
+
+static void raw_get_bool(nvs_handle_t h, const char *key, bool *out) {
+	uint8_t value;
+	if (nvs_get_u8(h, key, &value) == ESP_OK)
+		*out = value != 0;
+}
+
+// Pre-blob layout: one NVS key per field, named after the field. The keys
+// are left in place so a rollback to an older image still boots configured.
+static void config_load_legacy(nvs_handle_t h, SystemConfig *c) {
+	for (size_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+		const osj_config_field_t *f = &config_fields[i];
+		void *p = field_ptr(c, f);
+		switch (f->type) {
+		case OSJ_CFG_STR:
+			raw_get_str(h, f->key, p, f->size);
+			break;
+		case OSJ_CFG_FLOAT:
+			raw_get_float(h, f->key, p);
+			break;
+		case OSJ_CFG_UINT:
+			raw_get_uint(h, f->key, p);
+			break;
+		case OSJ_CFG_BOOL:
+			raw_get_bool(h, f->key, p);
+			break;
+		}
+	}
+}
+
+// Reads the record in one nvs_get_blob. On success *c holds defaults
+// overlaid with the stored fields and *version the stored schema version.
+static esp_err_t config_load_blob(nvs_handle_t h, SystemConfig *c,
+								  uint16_t *version) {
+	config_record_t rec;
+	uint8_t *buf = (uint8_t *)&rec;
+	uint8_t *big = NULL;
+	size_t size = sizeof(rec);
+
+	esp_err_t err = nvs_get_blob(h, CONFIG_KEY, buf, &size);
+	if (err == ESP_ERR_NVS_INVALID_LENGTH &&
+		nvs_get_blob(h, CONFIG_KEY, NULL, &size) == ESP_OK) {
+		// Written by a newer schema with more fields.
+		big = malloc(size);
+		if (!big)
+			return ESP_ERR_NO_MEM;
+		buf = big;
+		err = nvs_get_blob(h, CONFIG_KEY, buf, &size);
+	}
+	if (err != ESP_OK) {
+		free(big);
+		return err;
+	}
+
+	config_header_t hdr;
+	memcpy(&hdr, buf, sizeof(hdr));
+	const uint8_t *payload = buf + sizeof(hdr);
+	if (size < sizeof(hdr) || hdr.magic != CONFIG_MAGIC ||
+		hdr.size != size - sizeof(hdr) ||
+		esp_rom_crc32_le(0, payload, hdr.size) != hdr.crc) {
+		free(big);
+		return ESP_ERR_INVALID_CRC;
+	}
+
+	config_defaults(c);
+	memcpy(c, payload, hdr.size < sizeof(*c) ? hdr.size : sizeof(*c));
+	*version = hdr.version;
+	free(big);
+	return ESP_OK;
+}
+
+static esp_err_t config_save(const SystemConfig *c) {
+	config_record_t rec;
+	rec.hdr.magic = CONFIG_MAGIC;
+	rec.hdr.version = CONFIG_VERSION;
+	rec.hdr.size = sizeof(rec.cfg);
+	memcpy(&rec.cfg, c, sizeof(rec.cfg));
+	rec.hdr.crc = esp_rom_crc32_le(0, (const uint8_t *)&rec.cfg,
+								   sizeof(rec.cfg));
+
+	nvs_handle_t my_handle;
+	esp_err_t err = nvs_open(NAMESPACE, NVS_READWRITE, &my_handle);
+	if (err != ESP_OK)
+		return err;
+	// NVS writes the new blob before dropping the old one, so a power cut
+	// leaves either record intact.
+	err = nvs_set_blob(my_handle, CONFIG_KEY, &rec, sizeof(rec));
+	if (err == ESP_OK)
+		err = nvs_set_u32(my_handle, WRITES_KEY, record_writes + 1);
+	if (err == ESP_OK)
+		err = nvs_commit(my_handle);
+	nvs_close(my_handle);
+	if (err == ESP_OK)
+		record_writes++;
+	return err;
+}
+
+esp_err_t osj_config_flush(void) {
+	xSemaphoreTake(flush_mutex, portMAX_DELAY);
+	// Read before the copy: a commit racing with us is then flushed again
+	// later rather than marked as stored.
+	uint32_t gen = osj_config_generation();
+	esp_err_t err = ESP_OK;
+	if (gen != flushed_generation) {
+		SystemConfig cfg;
+		const SystemConfig *cur = osj_config_acquire();
+		cfg = *cur;
+		osj_config_release(cur);
+
+		err = config_save(&cfg);
+		if (err == ESP_OK) {
+			flushed_generation = gen;
+			flush_count++;
+		} else {
+			flush_failures++;
+			ESP_LOGE(TAG, "Config flush failed: %s", esp_err_to_name(err));
+		}
+	}
+	xSemaphoreGive(flush_mutex);
+	return err;
+}
+
+#if FLUSH_QUIET_MS > 0
+static void flush_task(void *arg) {
+	for (;;) {
+		// A failed flush is retried even if nothing else changes.
+		bool pending = osj_config_generation() != flushed_generation;
+		ulTaskNotifyTake(pdTRUE, pending ? pdMS_TO_TICKS(FLUSH_RETRY_MS)
+										 : portMAX_DELAY);
+		// Every further commit restarts the quiet period.
+		while (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(FLUSH_QUIET_MS)) != 0)
+			;
+		osj_config_flush();
+	}
+}
+
+// Runs from esp_restart(), so a controlled reboot keeps the last change.
+static void flush_on_shutdown(void) { osj_config_flush(); }
+#endif
 
 void osj_nvs_init(void) {
 	esp_err_t ret = nvs_flash_init();
@@ -30,184 +364,426 @@ void osj_nvs_init(void) {
 		ret = nvs_flash_init();
 	}
 	ESP_ERROR_CHECK(ret);
-    
-    config_mutex = xSemaphoreCreateMutex();
-    
-    osj_config_lock();
-    osj_nvs_get_str("apSsid", sys_config.apSsid, sizeof(sys_config.apSsid), "");
-    osj_nvs_get_str("apPasswd", sys_config.apPasswd, sizeof(sys_config.apPasswd), "");
-    osj_nvs_get_str("roomNo", sys_config.roomNo, sizeof(sys_config.roomNo), "0");
-    osj_nvs_get_str("authId", sys_config.authId, sizeof(sys_config.authId), "");
-    osj_nvs_get_str("authPasswd", sys_config.authPasswd, sizeof(sys_config.authPasswd), "");
-    
-    osj_nvs_get_str("ch1DeviceNo", sys_config.ch1DeviceNo, sizeof(sys_config.ch1DeviceNo), "1");
-    osj_nvs_get_str("ch2DeviceNo", sys_config.ch2DeviceNo, sizeof(sys_config.ch2DeviceNo), "2");
-    
-    sys_config.ch1CurrW = osj_nvs_get_float("ch1CurrW", 0.2);
-    sys_config.ch2CurrW = osj_nvs_get_float("ch2CurrW", 0.2);
-    sys_config.ch1FlowW = osj_nvs_get_uint("ch1FlowW", 50);
-    sys_config.ch2FlowW = osj_nvs_get_uint("ch2FlowW", 50);
-    sys_config.ch1CurrD = osj_nvs_get_float("ch1CurrD", 0.5);
-    sys_config.ch2CurrD = osj_nvs_get_float("ch2CurrD", 0.5);
-    
-    sys_config.ch1EndDelayW = osj_nvs_get_uint("ch1EndDelayW", 100000);
-    sys_config.ch2EndDelayW = osj_nvs_get_uint("ch2EndDelayW", 100000);
-    sys_config.ch1EndDelayD = osj_nvs_get_uint("ch1EndDelayD", 10000);
-    sys_config.ch2EndDelayD = osj_nvs_get_uint("ch2EndDelayD", 10000);
-    
-    sys_config.isCh1Live = osj_nvs_get_bool("isCh1Live", true);
-    sys_config.isCh2Live = osj_nvs_get_bool("isCh2Live", true);
-    
-    sys_config.hysteresisMargin = osj_nvs_get_float("hysteresisMargin", 0.05f);
-    osj_config_unlock();
+
+	save_mutex = xSemaphoreCreateMutex();
+	flush_mutex = xSemaphoreCreateMutex();
+	config_index_build();
+
+	SystemConfig cfg;
+	uint16_t version = 0;
+	bool save = false;
+	config_defaults(&cfg);
+
+	nvs_handle_t my_handle;
+	esp_err_t err = nvs_open(NAMESPACE, NVS_READWRITE, &my_handle);
+	if (err == ESP_OK) {
+		raw_get_uint(my_handle, WRITES_KEY, &record_writes);
+		err = config_load_blob(my_handle, &cfg, &version);
+		if (err == ESP_ERR_NVS_NOT_FOUND) {
+			ESP_LOGI(TAG, "Migrating per-key config to blob v%d",
+					 CONFIG_VERSION);
+			config_defaults(&cfg);
+			config_load_legacy(my_handle, &cfg);
+			save = true;
+		} else if (err != ESP_OK) {
+			// The per-key values predate the record, so falling back to them
+			// would quietly undo every change made since the migration. The
+			// bad record stays until the next commit replaces it.
+			ESP_LOGE(TAG, "Config record unusable (%s), using defaults",
+					 esp_err_to_name(err));
+			config_defaults(&cfg);
+		} else if (version < CONFIG_VERSION) {
+			ESP_LOGI(TAG, "Upgrading config record v%u -> v%d", version,
+					 CONFIG_VERSION);
+			save = true;
+		}
+		nvs_close(my_handle);
+	}
+
+	if (save && config_save(&cfg) != ESP_OK)
+		ESP_LOGE(TAG, "Failed to store config record");
+
+	osj_snapshot_init(&config_snap, &config_slots[0], &config_slots[1],
+					  sizeof(SystemConfig), &cfg);
+	flushed_generation = osj_config_generation();
+
+#if FLUSH_QUIET_MS > 0
+	xTaskCreate(flush_task, "cfg_flush", 3072, NULL, 2, &flush_task_handle);
+	esp_register_shutdown_handler(flush_on_shutdown);
+#endif
+}
+
+// Caller holds save_mutex.
+static esp_err_t commit_locked(const SystemConfig *next) {
+	// Only writers change the snapshot and we are the writer, so this copy
+	// stays current until we publish.
+	const SystemConfig *cur = osj_config_acquire();
+	bool same = memcmp(cur, next, sizeof(*cur)) == 0;
+	osj_config_release(cur);
+	if (same)
+		return ESP_OK;
+
+#if FLUSH_QUIET_MS > 0
+	osj_snapshot_publish(&config_snap, next);
+	commit_count++;
+	xTaskNotifyGive(flush_task_handle);
+	return ESP_OK;
+#else
+	esp_err_t err = config_save(next);
+	if (err != ESP_OK) {
+		ESP_LOGE(TAG, "Config commit failed: %s", esp_err_to_name(err));
+		return err;
+	}
+
+	osj_snapshot_publish(&config_snap, next);
+	commit_count++;
+	flushed_generation = osj_config_generation();
+	flush_count++;
+	return ESP_OK;
+#endif
+}
+
+static esp_err_t txn_fail(osj_config_txn_t *txn, const char *key,
+						  esp_err_t err) {
+	if (txn->err == ESP_OK) {
+		txn->err = err;
+		txn->bad_key = key;
+	}
+	return err;
 }
 
+void osj_config_begin(osj_config_txn_t *txn) {
+	xSemaphoreTake(save_mutex, portMAX_DELAY);
+	const SystemConfig *cur = osj_config_acquire();
+	txn->next = *cur;
+	osj_config_release(cur);
+	txn->err = ESP_OK;
+	txn->bad_key = NULL;
+}
+
+// Looks up a field of the given type. Unknown keys give ESP_ERR_NOT_FOUND,
+// keys of another type ESP_ERR_INVALID_ARG.
+static const osj_config_field_t *find_typed(const char *key,
+											osj_config_type_t type,
+											esp_err_t *err) {
+	const osj_config_field_t *f = osj_config_find(key, strlen(key));
+	if (!f) {
+		*err = ESP_ERR_NOT_FOUND;
+		return NULL;
+	}
+	if (f->type != type) {
+		*err = ESP_ERR_INVALID_ARG;
+		return NULL;
+	}
+	return f;
+}
+
+esp_err_t osj_config_set_str(osj_config_txn_t *txn, const char *key,
+							 const char *value) {
+	esp_err_t err;
+	const osj_config_field_t *f = find_typed(key, OSJ_CFG_STR, &err);
+	if (!f)
+		return txn_fail(txn, key, err);
+	if (strlen(value) >= f->size)
+		return txn_fail(txn, f->key, ESP_ERR_INVALID_SIZE);
+	strlcpy(field_ptr(&txn->next, f), value, f->size);
+	return ESP_OK;
+}
+
+esp_err_t osj_config_set_float(osj_config_txn_t *txn, const char *key,
+							   float value) {
+	esp_err_t err;
+	const osj_config_field_t *f = find_typed(key, OSJ_CFG_FLOAT, &err);
+	if (!f)
+		return txn_fail(txn, key, err);
+	*(float *)field_ptr(&txn->next, f) = value;
+	return ESP_OK;
+}
+
+esp_err_t osj_config_set_uint(osj_config_txn_t *txn, const char *key,
+							  uint32_t value) {
+	esp_err_t err;
+	const osj_config_field_t *f = find_typed(key, OSJ_CFG_UINT, &err);
+	if (!f)
+		return txn_fail(txn, key, err);
+	*(uint32_t *)field_ptr(&txn->next, f) = value;
+	return ESP_OK;
+}
+
+esp_err_t osj_config_set_bool(osj_config_txn_t *txn, const char *key,
+							  bool value) {
+	esp_err_t err;
+	const osj_config_field_t *f = find_typed(key, OSJ_CFG_BOOL, &err);
+	if (!f)
+		return txn_fail(txn, key, err);
+	*(bool *)field_ptr(&txn->next, f) = value;
+	return ESP_OK;
+}
+
+esp_err_t osj_config_set_json(osj_config_txn_t *txn,
+							  const osj_config_field_t *f, const cJSON *v) {
+	switch (f->type) {
+	case OSJ_CFG_STR:
+		if (!cJSON_IsString(v))
+			break;
+		return osj_config_set_str(txn, f->key, v->valuestring);
+	case OSJ_CFG_FLOAT:
+		if (!cJSON_IsNumber(v))
+			break;
+		return osj_config_set_float(txn, f->key, (float)v->valuedouble);
+	case OSJ_CFG_UINT:
+		if (!cJSON_IsNumber(v) || v->valuedouble < 0 ||
+			v->valuedouble > UINT32_MAX ||
+			v->valuedouble != (double)(uint32_t)v->valuedouble)
+			break;
+		return osj_config_set_uint(txn, f->key, (uint32_t)v->valuedouble);
+	case OSJ_CFG_BOOL:
+		if (!cJSON_IsBool(v))
+			break;
+		return osj_config_set_bool(txn, f->key, cJSON_IsTrue(v));
+	}
+	return txn_fail(txn, f->key, ESP_ERR_INVALID_ARG);
+}
+
+esp_err_t osj_config_validate(osj_config_txn_t *txn) {
+	if (txn->err != ESP_OK)
+		return txn->err;
+
+	for (size_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+		const osj_config_field_t *f = &config_fields[i];
+		const void *p = field_ptr(&txn->next, f);
+		float v;
+		if (f->type == OSJ_CFG_FLOAT)
+			v = *(const float *)p;
+		else if (f->type == OSJ_CFG_UINT)
+			v = (float)*(const uint32_t *)p;
+		else
+			continue;
+		// Written so that NaN fails too.
+		if (!(v >= f->min && v <= f->max))
+			return txn_fail(txn, f->key, ESP_ERR_INVALID_ARG);
+	}
+	return ESP_OK;
+}
+
+esp_err_t osj_config_commit(osj_config_txn_t *txn) {
+	esp_err_t err = osj_config_validate(txn);
+	if (err == ESP_OK)
+		err = commit_locked(&txn->next);
+	else
+		ESP_LOGW(TAG, "Config rejected at %s: %s",
+				 txn->bad_key ? txn->bad_key : "?", esp_err_to_name(err));
+	xSemaphoreGive(save_mutex);
+	return err;
+}
+
+void osj_config_abort(osj_config_txn_t *txn) { xSemaphoreGive(save_mutex); }
+
 void osj_nvs_set_str(const char *key, const char *value) {
+	osj_config_txn_t txn;
+	osj_config_begin(&txn);
+	if (osj_config_set_str(&txn, key, value) != ESP_ERR_NOT_FOUND) {
+		osj_config_commit(&txn);
+		return;
+	}
+	osj_config_abort(&txn);
+
 	nvs_handle_t my_handle;
 	esp_err_t err = nvs_open(NAMESPACE, NVS_READWRITE, &my_handle);
 	if (err != ESP_OK)
 		return;
 
 	err = nvs_set_str(my_handle, key, value);
-	if (err == ESP_OK) {
-		nvs_commit(my_handle);
-
-        osj_config_lock();
-        if (strcmp(key, "apSsid") == 0) strncpy(sys_config.apSsid, value, sizeof(sys_config.apSsid));
-        else if (strcmp(key, "apPasswd") == 0) strncpy(sys_config.apPasswd, value, sizeof(sys_config.apPasswd));
-        else if (strcmp(key, "roomNo") == 0) strncpy(sys_config.roomNo, value, sizeof(sys_config.roomNo));
-        else if (strcmp(key, "authId") == 0) strncpy(sys_config.authId, value, sizeof(sys_config.authId));
-        else if (strcmp(key, "authPasswd") == 0) strncpy(sys_config.authPasswd, value, sizeof(sys_config.authPasswd));
-        else if (strcmp(key, "ch1DeviceNo") == 0) strncpy(sys_config.ch1DeviceNo, value, sizeof(sys_config.ch1DeviceNo));
-        else if (strcmp(key, "ch2DeviceNo") == 0) strncpy(sys_config.ch2DeviceNo, value, sizeof(sys_config.ch2DeviceNo));
-        osj_config_unlock();
-    }
+	if (err == ESP_OK && nvs_commit(my_handle) == ESP_OK)
+		raw_writes++;
 	nvs_close(my_handle);
 }
 
 void osj_nvs_get_str(const char *key, char *out_value, size_t max_len,
 					 const char *default_value) {
-	nvs_handle_t my_handle;
-	esp_err_t err = nvs_open(NAMESPACE, NVS_READONLY, &my_handle);
-	if (err != ESP_OK) {
-		snprintf(out_value, max_len, "%s", default_value);
+	esp_err_t err;
+	const osj_config_field_t *f = find_typed(key, OSJ_CFG_STR, &err);
+	if (f) {
+		const SystemConfig *cfg = osj_config_acquire();
+		snprintf(out_value, max_len, "%s", (const char *)field_cptr(cfg, f));
+		osj_config_release(cfg);
 		return;
 	}
 
-	size_t required_size;
-	err = nvs_get_str(my_handle, key, NULL, &required_size);
-	if (err == ESP_OK && required_size <= max_len) {
-		nvs_get_str(my_handle, key, out_value, &required_size);
-	} else {
-		snprintf(out_value, max_len, "%s", default_value);
-	}
+	snprintf(out_value, max_len, "%s", default_value);
+	nvs_handle_t my_handle;
+	if (nvs_open(NAMESPACE, NVS_READONLY, &my_handle) != ESP_OK)
+		return;
+	raw_get_str(my_handle, key, out_value, max_len);
 	nvs_close(my_handle);
 }
 
 void osj_nvs_set_float(const char *key, float value) {
+	osj_config_txn_t txn;
+	osj_config_begin(&txn);
+	if (osj_config_set_float(&txn, key, value) != ESP_ERR_NOT_FOUND) {
+		osj_config_commit(&txn);
+		return;
+	}
+	osj_config_abort(&txn);
+
 	nvs_handle_t my_handle;
 	esp_err_t err = nvs_open(NAMESPACE, NVS_READWRITE, &my_handle);
 	if (err != ESP_OK)
 		return;
 
 	err = nvs_set_blob(my_handle, key, &value, sizeof(float));
-	if (err == ESP_OK) {
-		nvs_commit(my_handle);
-
-        osj_config_lock();
-        if (strcmp(key, "ch1CurrW") == 0) sys_config.ch1CurrW = value;
-        else if (strcmp(key, "ch2CurrW") == 0) sys_config.ch2CurrW = value;
-        else if (strcmp(key, "ch1CurrD") == 0) sys_config.ch1CurrD = value;
-        else if (strcmp(key, "ch2CurrD") == 0) sys_config.ch2CurrD = value;
-        else if (strcmp(key, "hysteresisMargin") == 0) sys_config.hysteresisMargin = value;
-        osj_config_unlock();
-    }
+	if (err == ESP_OK && nvs_commit(my_handle) == ESP_OK)
+		raw_writes++;
 	nvs_close(my_handle);
 }
 
 float osj_nvs_get_float(const char *key, float default_value) {
+	esp_err_t err;
+	float value = default_value;
+	const osj_config_field_t *f = find_typed(key, OSJ_CFG_FLOAT, &err);
+	if (f) {
+		const SystemConfig *cfg = osj_config_acquire();
+		value = *(const float *)field_cptr(cfg, f);
+		osj_config_release(cfg);
+		return value;
+	}
+
 	nvs_handle_t my_handle;
-	esp_err_t err = nvs_open(NAMESPACE, NVS_READONLY, &my_handle);
-	if (err != ESP_OK)
+	if (nvs_open(NAMESPACE, NVS_READONLY, &my_handle) != ESP_OK)
 		return default_value;
-
-	float value = 0.0f;
-	size_t size = sizeof(float);
-	err = nvs_get_blob(my_handle, key, &value, &size);
+	raw_get_float(my_handle, key, &value);
 	nvs_close(my_handle);
-
-	if (err == ESP_OK && size == sizeof(float)) {
-		return value;
-	}
-	return default_value;
+	return value;
 }
 
 void osj_nvs_set_uint(const char *key, uint32_t value) {
+	osj_config_txn_t txn;
+	osj_config_begin(&txn);
+	if (osj_config_set_uint(&txn, key, value) != ESP_ERR_NOT_FOUND) {
+		osj_config_commit(&txn);
+		return;
+	}
+	osj_config_abort(&txn);
+
 	nvs_handle_t my_handle;
 	esp_err_t err = nvs_open(NAMESPACE, NVS_READWRITE, &my_handle);
 	if (err != ESP_OK)
 		return;
 
 	err = nvs_set_u32(my_handle, key, value);
-	if (err == ESP_OK) {
-		nvs_commit(my_handle);
-        osj_config_lock();
-        if (strcmp(key, "ch1FlowW") == 0) sys_config.ch1FlowW = value;
-        else if (strcmp(key, "ch2FlowW") == 0) sys_config.ch2FlowW = value;
-        else if (strcmp(key, "ch1EndDelayW") == 0) sys_config.ch1EndDelayW = value;
-        else if (strcmp(key, "ch2EndDelayW") == 0) sys_config.ch2EndDelayW = value;
-        else if (strcmp(key, "ch1EndDelayD") == 0) sys_config.ch1EndDelayD = value;
-        else if (strcmp(key, "ch2EndDelayD") == 0) sys_config.ch2EndDelayD = value;
-        osj_config_unlock();
-    }
+	if (err == ESP_OK && nvs_commit(my_handle) == ESP_OK)
+		raw_writes++;
 	nvs_close(my_handle);
 }
 
 uint32_t osj_nvs_get_uint(const char *key, uint32_t default_value) {
+	esp_err_t err;
+	uint32_t value = default_value;
+	const osj_config_field_t *f = find_typed(key, OSJ_CFG_UINT, &err);
+	if (f) {
+		const SystemConfig *cfg = osj_config_acquire();
+		value = *(const uint32_t *)field_cptr(cfg, f);
+		osj_config_release(cfg);
+		return value;
+	}
+
 	nvs_handle_t my_handle;
-	esp_err_t err = nvs_open(NAMESPACE, NVS_READONLY, &my_handle);
-	if (err != ESP_OK)
+	if (nvs_open(NAMESPACE, NVS_READONLY, &my_handle) != ESP_OK)
 		return default_value;
-
-	uint32_t value = 0;
-	err = nvs_get_u32(my_handle, key, &value);
+	raw_get_uint(my_handle, key, &value);
 	nvs_close(my_handle);
-
-	if (err == ESP_OK) {
-		return value;
-	}
-	return default_value;
+	return value;
 }
 
 void osj_nvs_set_bool(const char *key, bool value) {
+	osj_config_txn_t txn;
+	osj_config_begin(&txn);
+	if (osj_config_set_bool(&txn, key, value) != ESP_ERR_NOT_FOUND) {
+		osj_config_commit(&txn);
+		return;
+	}
+	osj_config_abort(&txn);
+
 	nvs_handle_t my_handle;
 	esp_err_t err = nvs_open(NAMESPACE, NVS_READWRITE, &my_handle);
 	if (err != ESP_OK)
 		return;
 
 	err = nvs_set_u8(my_handle, key, value ? 1 : 0);
-	if (err == ESP_OK) {
-		nvs_commit(my_handle);
-        osj_config_lock();
-        if (strcmp(key, "isCh1Live") == 0) sys_config.isCh1Live = value;
-        else if (strcmp(key, "isCh2Live") == 0) sys_config.isCh2Live = value;
-        osj_config_unlock();
-    }
+	if (err == ESP_OK && nvs_commit(my_handle) == ESP_OK)
+		raw_writes++;
 	nvs_close(my_handle);
 }
 
 bool osj_nvs_get_bool(const char *key, bool default_value) {
+	esp_err_t err;
+	bool value = default_value;
+	const osj_config_field_t *f = find_typed(key, OSJ_CFG_BOOL, &err);
+	if (f) {
+		const SystemConfig *cfg = osj_config_acquire();
+		value = *(const bool *)field_cptr(cfg, f);
+		osj_config_release(cfg);
+		return value;
+	}
+
 	nvs_handle_t my_handle;
-	esp_err_t err = nvs_open(NAMESPACE, NVS_READONLY, &my_handle);
-	if (err != ESP_OK)
+	if (nvs_open(NAMESPACE, NVS_READONLY, &my_handle) != ESP_OK)
 		return default_value;
+	raw_get_bool(my_handle, key, &value);
+	nvs_close(my_handle);
+	return value;
+}
+
+esp_err_t osj_nvs_set_blob(const char *key, const void *data, size_t len) {
+	nvs_handle_t my_handle;
+	esp_err_t err = nvs_open(NAMESPACE, NVS_READWRITE, &my_handle);
+	if (err != ESP_OK)
+		return err;
+
+	err = nvs_set_blob(my_handle, key, data, len);
+	if (err == ESP_OK)
+		err = nvs_commit(my_handle);
+	if (err == ESP_OK)
+		raw_writes++;
+	nvs_close(my_handle);
+	return err;
+}
 
-	uint8_t value = 0;
-	err = nvs_get_u8(my_handle, key, &value);
+esp_err_t osj_nvs_get_blob(const char *key, void *data, size_t *len) {
+	nvs_handle_t my_handle;
+	esp_err_t err = nvs_open(NAMESPACE, NVS_READONLY, &my_handle);
+	if (err != ESP_OK)
+		return err;
+	err = nvs_get_blob(my_handle, key, data, len);
 	nvs_close(my_handle);
+	return err;
+}
 
-	if (err == ESP_OK) {
-		return value != 0;
+int osj_nvs_format_stats(char *buf, size_t len) {
+	nvs_stats_t st = {0};
+	nvs_get_stats(NULL, &st);
+	bool pending = osj_config_generation() != flushed_generation;
+	return snprintf(buf, len, "%" PRIu32 " record, %" PRIu32 " key writes, %u/%u free%s",
+					record_writes, raw_writes, (unsigned)st.free_entries,
+					(unsigned)st.total_entries, pending ? ", pending" : "");
+}
+
+cJSON *osj_nvs_get_stats_json(void) {
+	cJSON *obj = cJSON_CreateObject();
+	cJSON_AddBoolToObject(obj, "pending",
+						  osj_config_generation() != flushed_generation);
+	cJSON_AddNumberToObject(obj, "commits", commit_count);
+	cJSON_AddNumberToObject(obj, "flushes", flush_count);
+	cJSON_AddNumberToObject(obj, "flushFailed", flush_failures);
+	cJSON_AddNumberToObject(obj, "recordWrites", record_writes);
+	cJSON_AddNumberToObject(obj, "keyWrites", raw_writes);
+
+	nvs_stats_t st;
+	if (nvs_get_stats(NULL, &st) == ESP_OK) {
+		cJSON_AddNumberToObject(obj, "usedEntries", st.used_entries);
+		cJSON_AddNumberToObject(obj, "freeEntries", st.free_entries);
+		cJSON_AddNumberToObject(obj, "totalEntries", st.total_entries);
 	}
-	return default_value;
-}
\ No newline at end of file
+	return obj;
+}
@@ -0,0 +1,19 @@
+#ifndef OSJ_REMOTE_H
+#define OSJ_REMOTE_H
+
+/**
+ * @brief 서버 원격 명령(GetData, SetConfig, Reboot, Flush)을 등록한다.
+ * @details 모든 명령은 "cid"를 붙여 보내면 같은 값이 담긴
+ * {"title":"Response",...} 프레임으로 결과를 돌려받는다.
+ * - GetData: {"status":{...},"config":{...}} 현재 상태와 비밀이 아닌 설정을
+ *   응답한다.
+ * - SetConfig: {"config":{"ch1CurrW":0.3,...}} 전체를 검증한 뒤 한 번에
+ *   적용한다. 하나라도 잘못되면 아무것도 바뀌지 않고 "field"에 키를 담는다.
+ * - Reboot: 응답을 보낸 뒤 재부팅한다.
+ * - Flush: ACK 대기 중인 프레임을 즉시 재전송한다.
+ * @note osj_websocket_start() 전후 어느 때나 호출할 수 있다. 등록 전에
+ * 도착한 명령은 모르는 명령으로 처리된다.
+ */
+void osj_remote_init(void);
+
+#endif
@@ -0,0 +1,93 @@
+#include "osj_remote.h"
+#include "cJSON.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "laundry_core.h"
+#include "osj_nvs.h"
+#include "osj_websocket.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "OSJ_REMOTE";
+
+// Leaves time for the response frame to reach the server before resetting.
+#define REBOOT_DELAY_US (1500 * 1000)
+
+static esp_timer_handle_t reboot_timer = NULL;
+
+// Only fields flagged OSJ_CFG_REMOTE (detection tuning) are writable here.
+// Network credentials and device numbers stay on the local setup page.
+static const osj_config_field_t *find_field(const char *key) {
+	const osj_config_field_t *f = osj_config_find(key, strlen(key));
+	return (f && (f->flags & OSJ_CFG_REMOTE)) ? f : NULL;
+}
+
+static esp_err_t cmd_get_data(const cJSON *req, cJSON *result) {
+	char *status = laundry_core_get_status_json();
+	if (!status)
+		return ESP_ERR_NO_MEM;
+	cJSON_AddRawToObject(result, "status", status);
+	free(status);
+	cJSON_AddItemToObject(result, "config", osj_config_get_json());
+	return ESP_OK;
+}
+
+static esp_err_t cmd_set_config(const cJSON *req, cJSON *result) {
+	const cJSON *changes = cJSON_GetObjectItem(req, "config");
+	if (!cJSON_IsObject(changes))
+		return ESP_ERR_INVALID_ARG;
+
+	osj_config_txn_t txn;
+	osj_config_begin(&txn);
+
+	const cJSON *item;
+	cJSON_ArrayForEach(item, changes) {
+		const osj_config_field_t *f = find_field(item->string);
+		esp_err_t err = f ? osj_config_set_json(&txn, f, item) : ESP_ERR_NOT_FOUND;
+		if (err != ESP_OK) {
+			osj_config_abort(&txn);
+			cJSON_AddStringToObject(result, "field", item->string);
+			return err;
+		}
+	}
+
+	esp_err_t err = osj_config_commit(&txn);
+	if (err == ESP_OK) {
+		ESP_LOGI(TAG, "Applied %d config values",
+				 cJSON_GetArraySize(changes));
+	} else if (txn.bad_key) {
+		cJSON_AddStringToObject(result, "field", txn.bad_key);
+	}
+	return err;
+}
+
+static void reboot_cb(void *arg) { esp_restart(); }
+
+static esp_err_t cmd_reboot(const cJSON *req, cJSON *result) {
+	if (!reboot_timer) {
+		const esp_timer_create_args_t args = {.callback = reboot_cb,
+											  .name = "remote_reboot"};
+		esp_err_t err = esp_timer_create(&args, &reboot_timer);
+		if (err != ESP_OK)
+			return err;
+	}
+	ESP_LOGW(TAG, "Reboot requested by server");
+	esp_timer_stop(reboot_timer);
+	return esp_timer_start_once(reboot_timer, REBOOT_DELAY_US);
+}
+
+static esp_err_t cmd_flush(const cJSON *req, cJSON *result) {
+	osj_websocket_flush();
+	return ESP_OK;
+}
+
+void osj_remote_init(void) {
+	osj_websocket_register_command("GetData", cmd_get_data);
+	osj_websocket_register_command("SetConfig", cmd_set_config);
+	osj_websocket_register_command("Reboot", cmd_reboot);
+	osj_websocket_register_command("Flush", cmd_flush);
+}
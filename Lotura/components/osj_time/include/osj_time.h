@@ -0,0 +1,91 @@
+#ifndef OSJ_TIME_H
+#define OSJ_TIME_H
+
+#include "cJSON.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief 현재 시각의 신뢰도.
+ */
+typedef enum {
+	OSJ_TIME_NONE = 0,	 ///< 시각을 모름 (전원 투입 후 동기화 전)
+	OSJ_TIME_PROVISIONAL, ///< 리셋 전 RTC에 저장한 시각으로 추정한 값
+	OSJ_TIME_SYNCED,	  ///< 이번 부팅에서 SNTP로 동기화됨
+} osj_time_quality_t;
+
+/**
+ * @brief 이번 부팅의 첫 SNTP 동기화 때 한 번 호출되는 콜백.
+ * @param boot_utc_ms esp_timer 0 시점의 UTC 밀리초. "up" 스탬프를 UTC로
+ * 바꿀 때 더한다.
+ * @param shift_ms 임시("tp") 스탬프에 더해야 할 보정값 (밀리초)
+ */
+typedef void (*osj_time_sync_cb_t)(int64_t boot_utc_ms, int64_t shift_ms);
+
+/**
+ * @brief 시간 서비스를 초기화하고 SNTP 동기화 알림을 등록한다.
+ * @details 소프트 리셋 전에 RTC 메모리에 저장해 둔 시각이 있으면 RTC
+ * 타이머 경과분을 더해 임시 시각으로 복원한다. 이후 1분마다, 그리고
+ * esp_restart() 직전에 현재 시각을 다시 저장한다.
+ * @note SNTP를 시작하기 전(osj_wifi_init 전)에 호출해야 한다.
+ */
+void osj_time_init(void);
+
+/**
+ * @brief 첫 SNTP 동기화 콜백을 등록한다.
+ */
+void osj_time_set_first_sync_cb(osj_time_sync_cb_t cb);
+
+/**
+ * @brief 이번 부팅에서 SNTP 동기화가 되었는지 반환한다.
+ */
+bool osj_time_is_synced(void);
+
+/**
+ * @brief 현재 시각의 신뢰도를 반환한다.
+ */
+osj_time_quality_t osj_time_get_quality(void);
+
+/**
+ * @brief esp_timer 시각을 UTC 시각으로 변환한다.
+ * @details 마지막 SNTP 동기화 시점을 기준으로, 동기화 사이에 추정한
+ * 클럭 드리프트를 보정해 계산한다.
+ * @param mono_us esp_timer_get_time() 값
+ * @return UTC epoch 밀리초, 시각을 모르면 0
+ */
+int64_t osj_time_utc_ms(int64_t mono_us);
+
+/**
+ * @brief 현재 UTC 시각을 반환한다.
+ * @return UTC epoch 밀리초, 시각을 모르면 0
+ */
+int64_t osj_time_now_ms(void);
+
+/**
+ * @brief 현재 시각 스탬프를 JSON 필드 문자열로 만든다.
+ * @details 동기화됨: "ts":ms, 임시: "ts":ms,"tp":1, 모름: "up":부팅 후 ms
+ * @return snprintf와 같은 반환값
+ */
+int osj_time_format_stamp(char *buf, size_t len);
+
+/**
+ * @brief osj_time_format_stamp()와 같은 필드를 cJSON 객체에 추가한다.
+ */
+void osj_time_add_stamp(cJSON *obj);
+
+/**
+ * @brief UTC 밀리초를 ISO 8601 문자열("2024-01-01T00:00:00.000Z")로 만든다.
+ * @param utc_ms UTC epoch 밀리초 (0이면 빈 문자열)
+ * @param buf 결과 버퍼 (최소 25바이트)
+ * @param len 버퍼 크기
+ */
+void osj_time_format_iso(int64_t utc_ms, char *buf, size_t len);
+
+/**
+ * @brief 동기화 횟수, 드리프트 추정치, 마지막 보정 오차를 반환한다.
+ * @return cJSON 객체 (호출자가 cJSON_Delete 또는 다른 객체에 추가해야 함)
+ */
+cJSON *osj_time_get_json(void);
+
+#endif
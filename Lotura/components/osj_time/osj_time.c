@@ -0,0 +1,257 @@
+#include "osj_time.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "osj_boot.h"
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <sys/time.h>
+#include <time.h>
+#if !CONFIG_IDF_TARGET_LINUX
+#include "esp_attr.h"
+#include "esp_rom_crc.h"
+#include "esp_rtc_time.h"
+#include "esp_sntp.h"
+#endif
+
+static const char *TAG = "OSJ_TIME";
+
+// Drift is only re-estimated over spans long enough that SNTP jitter
+// (tens of ms) does not dominate, and is clamped to what a crystal can do.
+#define DRIFT_MIN_SPAN_US (10 * 60 * 1000000LL)
+#define DRIFT_MAX_PPB 500000
+
+// The host build (tools/ws_bench) has no RTC memory, RTC counter or SNTP
+// client. It takes the host clock, which is already synced, at init.
+#if !CONFIG_IDF_TARGET_LINUX
+// The RTC slow clock runs from the internal RC oscillator and is only good
+// to a few percent, so the saved pair is refreshed often to keep the span
+// bridged by it (save -> reset -> restore) short.
+#define RTC_SAVE_PERIOD_US (60 * 1000000LL)
+#define RTC_TIME_MAGIC 0x4f534a54
+
+typedef struct {
+	uint32_t magic;
+	int64_t rtc_us;
+	int64_t utc_us;
+	int32_t drift_ppb;
+	uint32_t crc;
+} rtc_time_t;
+
+static RTC_NOINIT_ATTR rtc_time_t rtc_time;
+static esp_timer_handle_t save_timer = NULL;
+#endif
+
+static portMUX_TYPE time_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static osj_time_quality_t quality = OSJ_TIME_NONE;
+static int64_t anchor_mono_us = 0;
+static int64_t anchor_utc_us = 0;
+static int32_t drift_ppb = 0;
+static int64_t last_error_us = 0;
+static uint32_t sync_count = 0;
+
+static osj_time_sync_cb_t first_sync_cb = NULL;
+
+// Caller holds time_mux.
+static int64_t map_locked(int64_t mono_us) {
+	int64_t delta = mono_us - anchor_mono_us;
+	return anchor_utc_us + delta + delta * drift_ppb / 1000000000LL;
+}
+
+#if !CONFIG_IDF_TARGET_LINUX
+static uint32_t rtc_time_crc(const rtc_time_t *t) {
+	return esp_rom_crc32_le(0, (const uint8_t *)t, offsetof(rtc_time_t, crc));
+}
+
+static void rtc_time_save(void) {
+	portENTER_CRITICAL(&time_mux);
+	if (quality == OSJ_TIME_NONE) {
+		portEXIT_CRITICAL(&time_mux);
+		return;
+	}
+	int64_t utc = map_locked(esp_timer_get_time());
+	int32_t ppb = drift_ppb;
+	portEXIT_CRITICAL(&time_mux);
+
+	rtc_time.magic = 0;
+	rtc_time.rtc_us = (int64_t)esp_rtc_get_time_us();
+	rtc_time.utc_us = utc;
+	rtc_time.drift_ppb = ppb;
+	rtc_time.crc = rtc_time_crc(&rtc_time);
+	rtc_time.magic = RTC_TIME_MAGIC;
+}
+
+static void save_timer_cb(void *arg) { rtc_time_save(); }
+
+// Runs from esp_restart(), so a soft reset loses at most the reset itself.
+static void shutdown_save(void) { rtc_time_save(); }
+
+static void rtc_time_restore(void) {
+	if (rtc_time.magic != RTC_TIME_MAGIC ||
+		rtc_time.crc != rtc_time_crc(&rtc_time))
+		return;
+
+	// The RTC counter restarts on power-on; a smaller value means the
+	// record belongs to an earlier power cycle.
+	int64_t rtc_now = (int64_t)esp_rtc_get_time_us();
+	if (rtc_now < rtc_time.rtc_us) {
+		rtc_time.magic = 0;
+		return;
+	}
+
+	anchor_mono_us = esp_timer_get_time();
+	anchor_utc_us = rtc_time.utc_us + (rtc_now - rtc_time.rtc_us);
+	drift_ppb = rtc_time.drift_ppb;
+	quality = OSJ_TIME_PROVISIONAL;
+	ESP_LOGI(TAG, "Restored provisional time from RTC (gap %" PRId64 " ms)",
+			 (rtc_now - rtc_time.rtc_us) / 1000);
+}
+#else
+static void rtc_time_save(void) {}
+#endif
+
+static void on_time_sync(struct timeval *tv) {
+	int64_t mono = esp_timer_get_time();
+	int64_t utc = (int64_t)tv->tv_sec * 1000000LL + tv->tv_usec;
+	bool first = false;
+	int64_t shift_us = 0;
+
+	portENTER_CRITICAL(&time_mux);
+	if (quality == OSJ_TIME_SYNCED) {
+		int64_t span = mono - anchor_mono_us;
+		int64_t err = utc - map_locked(mono);
+		last_error_us = err;
+		if (span >= DRIFT_MIN_SPAN_US) {
+			// Move halfway towards the drift this span implies, so one bad
+			// sample cannot swing the estimate.
+			int64_t step = err * 1000000000LL / span;
+			int64_t next = drift_ppb + step / 2;
+			if (next > DRIFT_MAX_PPB)
+				next = DRIFT_MAX_PPB;
+			if (next < -DRIFT_MAX_PPB)
+				next = -DRIFT_MAX_PPB;
+			drift_ppb = (int32_t)next;
+		}
+	} else {
+		first = true;
+		if (quality == OSJ_TIME_PROVISIONAL) {
+			shift_us = utc - map_locked(mono);
+			last_error_us = shift_us;
+		}
+	}
+	anchor_mono_us = mono;
+	anchor_utc_us = utc;
+	quality = OSJ_TIME_SYNCED;
+	sync_count++;
+	int64_t boot_utc_us = map_locked(0);
+	int64_t err_ms = last_error_us / 1000;
+	int32_t ppb = drift_ppb;
+	portEXIT_CRITICAL(&time_mux);
+
+	ESP_LOGI(TAG,
+			 "SNTP sync #%" PRIu32 " (error %" PRId64 " ms, drift %" PRId32
+			 " ppb)",
+			 sync_count, err_ms, ppb);
+	rtc_time_save();
+	if (first)
+		osj_boot_mark(OSJ_BOOT_SNTP);
+	if (first && first_sync_cb)
+		first_sync_cb(boot_utc_us / 1000, shift_us / 1000);
+}
+
+void osj_time_init(void) {
+#if CONFIG_IDF_TARGET_LINUX
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	on_time_sync(&tv);
+#else
+	rtc_time_restore();
+	sntp_set_time_sync_notification_cb(on_time_sync);
+	esp_register_shutdown_handler(shutdown_save);
+
+	const esp_timer_create_args_t args = {.callback = save_timer_cb,
+										  .name = "time_save"};
+	if (esp_timer_create(&args, &save_timer) == ESP_OK)
+		esp_timer_start_periodic(save_timer, RTC_SAVE_PERIOD_US);
+#endif
+}
+
+void osj_time_set_first_sync_cb(osj_time_sync_cb_t cb) { first_sync_cb = cb; }
+
+bool osj_time_is_synced(void) { return quality == OSJ_TIME_SYNCED; }
+
+osj_time_quality_t osj_time_get_quality(void) { return quality; }
+
+int64_t osj_time_utc_ms(int64_t mono_us) {
+	portENTER_CRITICAL(&time_mux);
+	int64_t utc = quality != OSJ_TIME_NONE ? map_locked(mono_us) : 0;
+	portEXIT_CRITICAL(&time_mux);
+	return utc / 1000;
+}
+
+int64_t osj_time_now_ms(void) {
+	return osj_time_utc_ms(esp_timer_get_time());
+}
+
+int osj_time_format_stamp(char *buf, size_t len) {
+	int64_t mono = esp_timer_get_time();
+	osj_time_quality_t q = quality;
+	int64_t utc_ms = osj_time_utc_ms(mono);
+
+	if (q == OSJ_TIME_SYNCED)
+		return snprintf(buf, len, "\"ts\":%" PRId64, utc_ms);
+	if (q == OSJ_TIME_PROVISIONAL)
+		return snprintf(buf, len, "\"ts\":%" PRId64 ",\"tp\":1", utc_ms);
+	return snprintf(buf, len, "\"up\":%" PRId64, mono / 1000);
+}
+
+void osj_time_add_stamp(cJSON *obj) {
+	int64_t mono = esp_timer_get_time();
+	osj_time_quality_t q = quality;
+	int64_t utc_ms = osj_time_utc_ms(mono);
+
+	if (q == OSJ_TIME_NONE) {
+		cJSON_AddNumberToObject(obj, "up", (double)(mono / 1000));
+		return;
+	}
+	cJSON_AddNumberToObject(obj, "ts", (double)utc_ms);
+	if (q == OSJ_TIME_PROVISIONAL)
+		cJSON_AddNumberToObject(obj, "tp", 1);
+}
+
+void osj_time_format_iso(int64_t utc_ms, char *buf, size_t len) {
+	if (utc_ms <= 0) {
+		if (len > 0)
+			buf[0] = '\0';
+		return;
+	}
+	time_t sec = (time_t)(utc_ms / 1000);
+	struct tm tm;
+	gmtime_r(&sec, &tm);
+	size_t n = strftime(buf, len, "%Y-%m-%dT%H:%M:%S", &tm);
+	snprintf(buf + n, len - n, ".%03dZ", (int)(utc_ms % 1000));
+}
+
+cJSON *osj_time_get_json(void) {
+	static const char *const quality_names[] = {"none", "provisional",
+												"synced"};
+
+	portENTER_CRITICAL(&time_mux);
+	osj_time_quality_t q = quality;
+	uint32_t count = sync_count;
+	int32_t ppb = drift_ppb;
+	int64_t err_us = last_error_us;
+	portEXIT_CRITICAL(&time_mux);
+
+	cJSON *obj = cJSON_CreateObject();
+	cJSON_AddBoolToObject(obj, "synced", q == OSJ_TIME_SYNCED);
+	cJSON_AddStringToObject(obj, "quality", quality_names[q]);
+	cJSON_AddNumberToObject(obj, "syncs", count);
+	cJSON_AddNumberToObject(obj, "drift_ppb", ppb);
+	cJSON_AddNumberToObject(obj, "last_error_ms", err_us / 1000.0);
+	cJSON_AddNumberToObject(obj, "now_ms", (double)osj_time_now_ms());
+	return obj;
+}
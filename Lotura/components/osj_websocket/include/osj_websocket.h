@@ -1,17 +1,109 @@
 #ifndef OSJ_WEBSOCKET_H
 #define OSJ_WEBSOCKET_H
 
+#include "cJSON.h"
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief 레인과 퍼블리셔 태스크만 만들고 연결은 하지 않는다.
+ * @details 네트워크가 준비되기 전에 생긴 이벤트를 잃지 않도록, 코어 태스크를
+ * 시작하기 전에 호출한다. 쌓인 프레임은 osj_websocket_start() 후 전송된다.
+ */
+void osj_websocket_init(void);
+
 /**
- * @brief 웹소켓 클라이언트를 시작한다.
+ * @brief 웹소켓 퍼블리셔 태스크를 만들고 클라이언트 연결을 요청한다.
+ * @details 실제 연결은 Kconfig로 고른 전송 백엔드(WebSocket 또는 MQTT)가
+ * 맡는다. 프레임 형식과 seq/Ack 규약은 백엔드와 무관하다.
+ * @note 클라이언트 핸들은 퍼블리셔 태스크만 다룬다. 송신 함수들은 프레임을
+ * 큐에 넣고 바로 반환한다.
  */
 void osj_websocket_start(void);
-void osj_websocket_restart(void);
+
+/**
+ * @brief 웹소켓 연결 상태.
+ */
+typedef enum {
+	OSJ_WS_STATE_IDLE = 0,     ///< 아직 시작하지 않음
+	OSJ_WS_STATE_UNREGISTERED, ///< 기기 번호가 기본값(1)이라 연결하지 않음
+	OSJ_WS_STATE_CONNECTING,   ///< 새 클라이언트가 첫 연결을 시도 중
+	OSJ_WS_STATE_CONNECTED,    ///< 서버와 연결됨
+	OSJ_WS_STATE_WAITING,      ///< 끊겨서 백오프 후 재연결 대기 중
+} osj_ws_state_t;
+
+/**
+ * @brief 퍼블리셔 태스크에 클라이언트 재시작을 요청한다 (블로킹하지 않음).
+ * @details 요청은 큐로 전달되며, 처리 전에 쌓인 요청들은 한 번의 재시작으로
+ * 합쳐진다. 어느 태스크에서 호출해도 안전하다.
+ * @return 요청 번호. osj_websocket_restart_done()으로 처리 여부를 확인한다.
+ */
+uint32_t osj_websocket_restart(void);
+
+/**
+ * @brief 해당 번호의 재시작 요청이 처리되었는지 확인한다.
+ * @param ticket osj_websocket_restart()가 반환한 번호
+ * @return 새 클라이언트가 만들어졌으면 true
+ */
+bool osj_websocket_restart_done(uint32_t ticket);
+
+/**
+ * @brief 현재 연결 상태를 반환한다.
+ */
+osj_ws_state_t osj_websocket_get_state(void);
+
+/**
+ * @brief 서버 ACK를 받은 프레임마다 호출되는 콜백.
+ * @param urgent 긴급 레인 프레임이면 true
+ * @param latency_us 큐 투입부터 ACK 수신까지 걸린 시간 (us)
+ */
+typedef void (*osj_websocket_ack_cb_t)(bool urgent, int64_t latency_us);
+
+/**
+ * @brief ACK 관찰 콜백을 등록한다 (벤치마크용, NULL이면 해제).
+ * @note 콜백은 퍼블리셔 태스크에서 실행되므로 짧게 끝나야 한다.
+ */
+void osj_websocket_set_ack_observer(osj_websocket_ack_cb_t cb);
+
+/**
+ * @brief 서버 명령 핸들러.
+ * @param req 수신한 명령 JSON 전체 ("title", "cid" 및 인자 포함)
+ * @param result 응답의 "data" 객체. 핸들러가 결과를 채운다.
+ * @return ESP_OK이면 "ok": true로 응답하고, 아니면 "error"에 오류 이름을 담는다.
+ */
+typedef esp_err_t (*osj_websocket_cmd_handler_t)(const cJSON *req,
+												  cJSON *result);
+
+/**
+ * @brief 서버가 보내는 명령("title" 값)에 대한 핸들러를 등록한다.
+ * @details 핸들러는 웹소켓 태스크에서 실행되며, 응답
+ * {"title":"Response","cmd":...,"cid":...,"ok":...,"data":{...}}은 긴급
+ * 레인으로 전송된다. "cid"는 요청에 있던 값을 그대로 돌려준다.
+ * @note 어느 태스크에서든, 발행 태스크가 이미 돌고 있어도 등록할 수 있다.
+ * 등록 전에 도착한 명령은 모르는 명령으로 처리된다.
+ * @param title 명령 이름 (정적 문자열)
+ * @param handler 핸들러 함수
+ * @return ESP_OK, 또는 등록 공간이 없으면 ESP_ERR_NO_MEM
+ */
+esp_err_t osj_websocket_register_command(const char *title,
+										 osj_websocket_cmd_handler_t handler);
+
+/**
+ * @brief ACK를 받지 못한 프레임을 즉시 다시 전송하도록 요청한다.
+ */
+void osj_websocket_flush(void);
 
 /**
  * @brief 특정 채널의 상태를 서버로 전송한다.
  * @param channel 채널 번호 (1 또는 2)
  * @param status 상태 값 (0: 동작 중, 1: 대기 중, 2: 연결 끊김, 3: 고장)
  * @param device_type 디바이스 타입 ("WASH" 또는 "DRY")
+ * @note 상태 프레임은 긴급(urgent) 레인으로 들어가 대기 중인 로그보다 먼저
+ * 전송된다.
+ * @note 모든 송신 프레임에는 단조 증가하는 "seq" 필드가 붙는다. 서버가
+ * {"title":"Ack","seq":N} 을 보내면 N 이하의 프레임은 전달 완료로 처리되고,
+ * 그 전에 연결이 끊기면 재연결 후 같은 seq로 재전송된다.
  */
 void osj_websocket_send_status(int channel, int status,
 							   const char *device_type);
@@ -19,8 +111,41 @@ void osj_websocket_send_status(int channel, int status,
 /**
  * @brief 특정 채널의 로그 데이터를 서버로 전송한다.
  * @param channel 채널 번호 (1 또는 2)
- * @param log_json JSON 형식의 로그 문자열
+ * @param log_json 로그 JSON 객체 문자열. 프레임에 그대로 끼워 넣으므로 객체가
+ * 아니면 빈 로그로 대신 보낸다.
+ * @note 로그 프레임은 벌크(bulk) 레인으로 전송된다.
  */
 void osj_websocket_send_log(int channel, const char *log_json);
 
+/**
+ * @brief 특정 채널의 센서 값을 텔레메트리 스트림에 넘긴다.
+ * @details CONFIG_OSJ_WS_TELEMETRY가 꺼져 있으면 아무것도 하지 않는다.
+ * 샘플 주기마다 마지막으로 보낸 값과 비교해 데드밴드를 넘은 필드만
+ * {"tseq":N,"id":N,"title":"Telemetry","t":ms,"rms":...,"flow":...,
+ * "drain":...,"rssi":...} 형태로 텔레메트리 레인에 보낸다. 다음 샘플이 곧
+ * 대신하므로 seq와 ACK 창을 쓰지 않고 한 번만 보낸다. tseq는 저장하지 않는
+ * RAM 카운터로, 서버가 빠진 프레임을 알아보는 데만 쓴다. 키프레임
+ * ("key":true)은 모든 필드를 담는다. 주기가 되지 않았으면 바로 반환하므로 매 루프마다 호출해도 된다.
+ * @note 한 태스크(laundry_core)에서만 호출해야 한다.
+ * @param channel 채널 번호 (1 또는 2)
+ * @param rms 전류 RMS 값
+ * @param flow_lph 유량 (L/h)
+ * @param drain 배수 센서 상태
+ */
+void osj_websocket_send_telemetry(int channel, float rms, uint32_t flow_lph,
+								  int drain);
+
+/**
+ * @brief 레인별 전송 통계와 큐 투입~송신 지연 히스토그램을 JSON으로 반환한다.
+ * @return JSON 문자열 (호출자가 free해야 함)
+ */
+char *osj_websocket_get_stats_json(void);
+
+/**
+ * @brief 링크 품질 통계(연결 시간, 핸드셰이크 시간, 가동률, 끊김 원인)를
+ * 반환한다.
+ * @return cJSON 객체 (호출자가 cJSON_Delete 또는 다른 객체에 추가해야 함)
+ */
+cJSON *osj_websocket_get_link_json(void);
+
 #endif
\ No newline at end of file
@@ -2,175 +2,768 @@
 #include "cJSON.h"
 #include "common_defs.h"
 #include "esp_log.h"
-#include "esp_websocket_client.h"
-#include "esp_crt_bundle.h"
-#include "mbedtls/base64.h"
+#include "esp_timer.h"
+#include "osj_boot.h"
 #include "osj_nvs.h"
+#include "osj_time.h"
+#include "osj_ws_identity.h"
+#include "osj_ws_link.h"
+#include "osj_ws_transport.h"
 #include "osj_wifi.h"
+#include <inttypes.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdbool.h>
-#include "osj_config.h"
+#include <math.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
 
 static const char *TAG = "OSJ_WS";
-static bool is_restarting = false;
-
-static esp_websocket_client_handle_t client = NULL;
-
-static void websocket_event_handler(void *handler_args, esp_event_base_t base,
-									int32_t event_id, void *event_data) {
-	esp_websocket_event_data_t *data = (esp_websocket_event_data_t *)event_data;
-	int client_num = (int)handler_args;
-
-	switch (event_id) {
-	case WEBSOCKET_EVENT_CONNECTED:
-		ESP_LOGI(TAG, "Client %d: WEBSOCKET_EVENT_CONNECTED", client_num);
-		break;
-	case WEBSOCKET_EVENT_DISCONNECTED:
-		ESP_LOGI(TAG, "Client %d: WEBSOCKET_EVENT_DISCONNECTED", client_num);
-		break;
-	case WEBSOCKET_EVENT_DATA:
-		if (data->op_code == WS_TRANSPORT_OPCODES_TEXT) {
-			char *payload = strndup(data->data_ptr, data->data_len);
-			if (payload) {
-				cJSON *json = cJSON_Parse(payload);
-				if (json) {
-					cJSON *title = cJSON_GetObjectItem(json, "title");
-					if (cJSON_IsString(title) &&
-						strcmp(title->valuestring, "GetData") == 0) {
-						ESP_LOGI(TAG, "Client %d: Received GetData request",
-								 client_num);
-					}
-					cJSON_Delete(json);
-				}
-				free(payload);
-			}
+
+#if CONFIG_OSJ_LINK_TRANSPORT_MQTT
+static const osj_ws_transport_t *const transport = &osj_ws_transport_mqtt;
+#else
+static const osj_ws_transport_t *const transport = &osj_ws_transport_websocket;
+#endif
+
+// Owned by publisher_task. No other task may touch it.
+static void *session = NULL;
+
+#define ACK_WINDOW CONFIG_OSJ_WS_ACK_WINDOW
+
+// Sequence numbers are reserved in NVS in blocks so they stay monotonic
+// across reboots without a flash write per frame.
+#define SEQ_RESERVE_BLOCK 256
+
+#define PUB_BIT_WAKE (1 << 0)
+#define PUB_BIT_LINK (1 << 1)
+#define PUB_BIT_FLUSH (1 << 2)
+
+#define MAX_COMMANDS 8
+
+typedef enum {
+	LANE_URGENT = 0,
+	LANE_BULK,
+	LANE_TELEMETRY,
+	LANE_COUNT
+} ws_lane_t;
+
+static const char *const lane_names[LANE_COUNT] = {"urgent", "bulk",
+												   "telemetry"};
+
+#define TELEMETRY_QUEUE_LEN 4
+
+// body is a complete JSON object; the publisher splices "seq" (or "tseq"
+// for telemetry) in front.
+typedef struct {
+	char *body;
+	int64_t enqueued_us;
+} lane_item_t;
+
+typedef struct {
+	uint32_t seq;
+	char *frame;
+	ws_lane_t lane;
+	int64_t enqueued_us;
+	bool on_wire;
+	bool ever_sent;
+} inflight_frame_t;
+
+// What the backend last reported, kept as a latest value under ctl_mux
+// instead of queued, so a connect, disconnect or ACK can never be lost to a
+// full queue. connects counts every connect, so the publisher also notices a
+// drop and reconnect that happened between two wake-ups. ACKs are
+// cumulative and only the highest one matters.
+typedef struct {
+	void *src;
+	bool up;
+	uint32_t connects;
+	void *ack_src;
+	bool ack_pending;
+	uint32_t ack_seq;
+} link_report_t;
+
+typedef struct {
+	uint32_t ticket;
+} ctl_req_t;
+
+static QueueHandle_t lanes[LANE_COUNT] = {NULL};
+static link_report_t link_report;
+static uint32_t connects_seen = 0;
+static QueueHandle_t ctl_queue = NULL;
+static TaskHandle_t publisher_handle = NULL;
+
+static portMUX_TYPE ctl_mux = portMUX_INITIALIZER_UNLOCKED;
+static bool started = false;
+static uint32_t restart_requested = 0;
+static volatile uint32_t restart_applied = 0;
+static volatile osj_ws_state_t conn_state = OSJ_WS_STATE_IDLE;
+
+static const char *const state_names[] = {"idle", "unregistered",
+										  "connecting", "connected",
+										  "waiting"};
+
+static inflight_frame_t inflight[ACK_WINDOW];
+static int inflight_head = 0;
+static int inflight_count = 0;
+static bool ws_connected = false;
+
+static uint32_t next_seq = 0;
+static uint32_t seq_reserved = 0;
+static uint32_t telemetry_seq = 0; // RAM only, restarts at 0 on boot
+
+typedef struct {
+	const char *title;
+	osj_websocket_cmd_handler_t handler;
+} ws_command_t;
+
+static ws_command_t commands[MAX_COMMANDS];
+static int command_count = 0;
+
+static const uint32_t latency_edges_ms[] = {1,	 2,	  5,   10,	20,	  50,
+											100, 200, 500, 1000, 5000};
+#define LATENCY_BUCKETS                                                        \
+	(sizeof(latency_edges_ms) / sizeof(latency_edges_ms[0]) + 1)
+
+static uint32_t lane_hist[LANE_COUNT][LATENCY_BUCKETS];
+static uint32_t lane_sent[LANE_COUNT];
+static uint32_t lane_dropped[LANE_COUNT];
+static uint32_t lane_acked[LANE_COUNT];
+
+static osj_websocket_ack_cb_t ack_observer = NULL;
+
+static void record_latency(ws_lane_t lane, int64_t latency_us) {
+	uint32_t ms = (uint32_t)(latency_us / 1000);
+	size_t i = 0;
+	while (i < LATENCY_BUCKETS - 1 && ms >= latency_edges_ms[i])
+		i++;
+	lane_hist[lane][i]++;
+	lane_sent[lane]++;
+}
+
+static uint32_t alloc_seq(void) {
+	if (next_seq >= seq_reserved) {
+		seq_reserved = next_seq + SEQ_RESERVE_BLOCK;
+		osj_nvs_set_uint("wsSeq", seq_reserved);
+	}
+	return next_seq++;
+}
+
+static void lane_push_json(ws_lane_t lane, cJSON *root);
+
+// Runs an inbound command on the websocket task and queues the response
+// on the urgent lane. Unknown commands are only answered when the server
+// asked for a reply by sending a correlation ID.
+static void dispatch_command(const cJSON *req, const char *title) {
+	osj_websocket_cmd_handler_t handler = NULL;
+	portENTER_CRITICAL(&ctl_mux);
+	for (int i = 0; i < command_count; i++) {
+		if (strcmp(commands[i].title, title) == 0) {
+			handler = commands[i].handler;
+			break;
+		}
+	}
+	portEXIT_CRITICAL(&ctl_mux);
+
+	const cJSON *cid = cJSON_GetObjectItem(req, "cid");
+	if (!handler && !cid) {
+		ESP_LOGW(TAG, "Ignoring unknown message \"%s\"", title);
+		return;
+	}
+
+	cJSON *resp = cJSON_CreateObject();
+	cJSON_AddStringToObject(resp, "title", "Response");
+	cJSON_AddStringToObject(resp, "cmd", title);
+	if (cid)
+		cJSON_AddItemToObject(resp, "cid", cJSON_Duplicate(cid, true));
+	cJSON *result = cJSON_AddObjectToObject(resp, "data");
+
+	esp_err_t err = handler ? handler(req, result) : ESP_ERR_NOT_SUPPORTED;
+	cJSON_AddBoolToObject(resp, "ok", err == ESP_OK);
+	if (err != ESP_OK) {
+		ESP_LOGW(TAG, "Command %s failed: %s", title, esp_err_to_name(err));
+		cJSON_AddStringToObject(resp, "error", esp_err_to_name(err));
+	}
+	lane_push_json(LANE_URGENT, resp);
+}
+
+static void count_drop(ws_lane_t lane) {
+	portENTER_CRITICAL(&ctl_mux);
+	lane_dropped[lane]++;
+	portEXIT_CRITICAL(&ctl_mux);
+}
+
+static void post_link(void *src, bool up) {
+	portENTER_CRITICAL(&ctl_mux);
+	link_report.src = src;
+	link_report.up = up;
+	if (up)
+		link_report.connects++;
+	portEXIT_CRITICAL(&ctl_mux);
+	if (publisher_handle)
+		xTaskNotify(publisher_handle, PUB_BIT_LINK, eSetBits);
+}
+
+static void post_ack(void *src, uint32_t seq) {
+	portENTER_CRITICAL(&ctl_mux);
+	if (!link_report.ack_pending || link_report.ack_src != src ||
+		(int32_t)(seq - link_report.ack_seq) > 0) {
+		link_report.ack_src = src;
+		link_report.ack_seq = seq;
+		link_report.ack_pending = true;
+	}
+	portEXIT_CRITICAL(&ctl_mux);
+	if (publisher_handle)
+		xTaskNotify(publisher_handle, PUB_BIT_LINK, eSetBits);
+}
+
+// Called from the backend's task.
+void osj_ws_transport_on_connected(void *session) { post_link(session, true); }
+
+void osj_ws_transport_on_disconnected(void *session) {
+	post_link(session, false);
+}
+
+void osj_ws_transport_on_message(void *session, const char *data,
+								 size_t len) {
+	char *payload = strndup(data, len);
+	if (!payload)
+		return;
+	cJSON *json = cJSON_Parse(payload);
+	free(payload);
+	if (!json)
+		return;
+
+	cJSON *title = cJSON_GetObjectItem(json, "title");
+	if (cJSON_IsString(title) && strcmp(title->valuestring, "Ack") == 0) {
+		cJSON *seq = cJSON_GetObjectItem(json, "seq");
+		if (cJSON_IsNumber(seq)) {
+			post_ack(session, (uint32_t)seq->valuedouble);
 		}
-		break;
-	case WEBSOCKET_EVENT_ERROR:
-		ESP_LOGI(TAG, "Client: WEBSOCKET_EVENT_ERROR");
-		break;
+	} else if (cJSON_IsString(title)) {
+		ESP_LOGI(TAG, "Received %s request", title->valuestring);
+		dispatch_command(json, title->valuestring);
 	}
+	cJSON_Delete(json);
 }
 
-static esp_websocket_client_handle_t
-start_client(const char *auth_b64, const char *room) {
-	static char headers[512];
-	
-	osj_config_lock();
-	int device_id = atoi(sys_config.ch1DeviceNo);
-	osj_config_unlock();
+static void restart_client(void) {
+	if (session != NULL) {
+		transport->disconnect(session);
+		session = NULL;
+	}
+	ws_connected = false;
 
-	if (device_id == 1) {
+	// The backends copy what they need, so the identity is returned as soon
+	// as the client is set up.
+	const osj_ws_identity_t *id = osj_ws_identity_acquire();
+	if (!id->registered) {
+		osj_ws_identity_release(id);
 		ESP_LOGW(TAG, "Device ID is default (1). Aborting connection.");
-		return NULL;
+		conn_state = OSJ_WS_STATE_UNREGISTERED;
+		return;
 	}
+	session = transport->connect(id);
+	osj_ws_identity_release(id);
+	conn_state = session ? OSJ_WS_STATE_CONNECTING : OSJ_WS_STATE_WAITING;
+}
 
-	snprintf(headers, sizeof(headers),
-			 "Authorization: Basic %s\r\n"
-			 "HWID: %d\r\n"
-			 "ROOM: %s\r\n",
-			 auth_b64, device_id, room);
+static void inflight_pop_front(void) {
+	free(inflight[inflight_head].frame);
+	inflight[inflight_head].frame = NULL;
+	inflight_head = (inflight_head + 1) % ACK_WINDOW;
+	inflight_count--;
+}
 
-	esp_websocket_client_config_t websocket_cfg = {};
-	websocket_cfg.uri = "wss://lotura-prod.xquare.app/device";
-	websocket_cfg.headers = headers;
-	websocket_cfg.network_timeout_ms = 10000;
-	websocket_cfg.ping_interval_sec = 10;
+// Anything not ACKed on the previous connection goes out again.
+static void mark_inflight_unsent(void) {
+	for (int i = 0; i < inflight_count; i++) {
+		inflight[(inflight_head + i) % ACK_WINDOW].on_wire = false;
+	}
+}
 
-	websocket_cfg.crt_bundle_attach = esp_crt_bundle_attach;
+static void handle_link(void) {
+	portENTER_CRITICAL(&ctl_mux);
+	link_report_t rep = link_report;
+	link_report.ack_pending = false;
+	portEXIT_CRITICAL(&ctl_mux);
 
-	esp_websocket_client_handle_t new_client =
-		esp_websocket_client_init(&websocket_cfg);
-	esp_websocket_register_events(new_client, WEBSOCKET_EVENT_ANY,
-								  websocket_event_handler, (void *)0);
-	esp_websocket_client_start(new_client);
-	return new_client;
+	// Reports from a session that was torn down by a restart are stale.
+	if (rep.src == session && session) {
+		if (rep.connects != connects_seen) {
+			connects_seen = rep.connects;
+			// Subscribe and resend only if the connection is still up;
+			// otherwise the next connect does it.
+			mark_inflight_unsent();
+			if (rep.up) {
+				ws_connected = true;
+				conn_state = OSJ_WS_STATE_CONNECTED;
+				osj_boot_mark(OSJ_BOOT_CONNECTED);
+				if (transport->subscribe(session, "cmd") != ESP_OK)
+					ESP_LOGW(TAG, "Command channel subscribe failed");
+				if (inflight_count > 0) {
+					ESP_LOGI(TAG, "Retransmitting %d unacked frame(s)",
+							 inflight_count);
+				}
+			}
+		}
+		if (!rep.up) {
+			ws_connected = false;
+			conn_state = OSJ_WS_STATE_WAITING;
+		}
+	}
+
+	if (rep.ack_pending && rep.ack_src == session && session) {
+		// Server ACKs are cumulative: everything up to and including seq.
+		while (inflight_count > 0 &&
+			   (int32_t)(inflight[inflight_head].seq - rep.ack_seq) <= 0) {
+			inflight_frame_t *f = &inflight[inflight_head];
+			lane_acked[f->lane]++;
+			if (ack_observer)
+				ack_observer(f->lane == LANE_URGENT,
+							 esp_timer_get_time() - f->enqueued_us);
+			inflight_pop_front();
+		}
+	}
 }
 
-void osj_websocket_start(void) {
-	ESP_LOGI(TAG, "Starting WebSocket Clients...");
+// Moves frames from the lanes into the ACK window. Urgent frames always go
+// first, and one slot is kept free of bulk traffic so a state change never
+// waits behind queued telemetry.
+static void admit_from_lanes(void) {
+	int bulk_limit = (ACK_WINDOW > 1) ? ACK_WINDOW - 1 : 1;
+
+	while (ws_connected && inflight_count < ACK_WINDOW) {
+		lane_item_t item;
+		ws_lane_t lane = LANE_URGENT;
+		if (xQueueReceive(lanes[LANE_URGENT], &item, 0) != pdPASS) {
+			if (inflight_count >= bulk_limit ||
+				xQueueReceive(lanes[LANE_BULK], &item, 0) != pdPASS)
+				break;
+			lane = LANE_BULK;
+		}
+
+		uint32_t seq = alloc_seq();
+		size_t len = strlen(item.body) + 24;
+		char *json_str = malloc(len);
+		if (!json_str) {
+			free(item.body);
+			count_drop(lane);
+			continue;
+		}
+		snprintf(json_str, len, "{\"seq\":%" PRIu32 ",%s", seq, item.body + 1);
+		free(item.body);
+
+		inflight_frame_t *f =
+			&inflight[(inflight_head + inflight_count) % ACK_WINDOW];
+		f->seq = seq;
+		f->frame = json_str;
+		f->lane = lane;
+		f->enqueued_us = item.enqueued_us;
+		f->on_wire = false;
+		f->ever_sent = false;
+		inflight_count++;
+	}
+}
+
+// Returns true if a frame is still waiting to go on the wire.
+static bool pump_inflight(void) {
+	if (!session || !ws_connected)
+		return inflight_count > 0;
+
+	for (int i = 0; i < inflight_count; i++) {
+		inflight_frame_t *f = &inflight[(inflight_head + i) % ACK_WINDOW];
+		if (f->on_wire)
+			continue;
+		int ret = transport->publish(session, f->frame, strlen(f->frame), 100);
+		if (ret < 0) {
+			ESP_LOGW(TAG, "Send of seq %" PRIu32 " failed, will retry", f->seq);
+			return true;
+		}
+		f->on_wire = true;
+		if (!f->ever_sent) {
+			f->ever_sent = true;
+			record_latency(f->lane, esp_timer_get_time() - f->enqueued_us);
+		}
+	}
+	return false;
+}
+
+// Telemetry is superseded by the next sample, so it bypasses the ACK
+// window: no persisted seq, no retransmit, sent once after the sequenced
+// frames. "tseq" only lets the server spot gaps.
+static void pump_telemetry(void) {
+	lane_item_t item;
+	while (session && ws_connected &&
+		   xQueueReceive(lanes[LANE_TELEMETRY], &item, 0) == pdPASS) {
+		size_t len = strlen(item.body) + 24;
+		char *frame = malloc(len);
+		if (frame) {
+			snprintf(frame, len, "{\"tseq\":%" PRIu32 ",%s", telemetry_seq++,
+					 item.body + 1);
+			if (transport->publish(session, frame, strlen(frame), 100) >= 0)
+				record_latency(LANE_TELEMETRY,
+							   esp_timer_get_time() - item.enqueued_us);
+			else
+				count_drop(LANE_TELEMETRY);
+			free(frame);
+		} else {
+			count_drop(LANE_TELEMETRY);
+		}
+		free(item.body);
+	}
+}
 
-	char auth_id[32], auth_pass[32], room[16];
-	osj_nvs_get_str("authId", auth_id, sizeof(auth_id), "");
-	osj_nvs_get_str("authPasswd", auth_pass, sizeof(auth_pass), "");
-	osj_nvs_get_str("roomNo", room, sizeof(room), "0");
+static void publisher_task(void *pvParameters) {
+	TickType_t wait = portMAX_DELAY;
 
-	char auth_str[65];
-	snprintf(auth_str, sizeof(auth_str), "%s:%s", auth_id, auth_pass);
-	unsigned char auth_b64[100];
-	size_t out_len;
-	mbedtls_base64_encode(auth_b64, sizeof(auth_b64), &out_len,
-						  (unsigned char *)auth_str, strlen(auth_str));
+	while (1) {
+		uint32_t bits = 0;
+		xTaskNotifyWait(0, UINT32_MAX, &bits, wait);
 
-	client = start_client((char *)auth_b64, room);
+		// Back-to-back requests collapse into a single restart.
+		ctl_req_t req;
+		uint32_t ticket = 0;
+		while (xQueueReceive(ctl_queue, &req, 0) == pdPASS) {
+			ticket = req.ticket;
+		}
+		if (ticket) {
+			restart_client();
+			restart_applied = ticket;
+		}
+		if (bits & PUB_BIT_FLUSH) {
+			mark_inflight_unsent();
+		}
+
+		if (bits & PUB_BIT_LINK)
+			handle_link();
+
+		admit_from_lanes();
+		bool pending = pump_inflight();
+		if (!pending)
+			pump_telemetry();
+		wait = pending ? pdMS_TO_TICKS(100) : portMAX_DELAY;
+	}
 }
 
-void osj_websocket_restart(void) {
-	if (is_restarting) {
-		ESP_LOGW(TAG, "Restart already in progress, ignoring request.");
+// Takes ownership of body.
+static void lane_push(ws_lane_t lane, char *body) {
+	if (!body)
+		return;
+	if (!lanes[lane]) {
+		free(body);
 		return;
 	}
-	is_restarting = true;
 
-	if (client != NULL) {
-		ESP_LOGI(TAG, "Stopping WebSocket Client for restart...");
-		esp_websocket_client_stop(client);
-		esp_websocket_client_destroy(client);
-		client = NULL;
+	lane_item_t item = {.body = body, .enqueued_us = esp_timer_get_time()};
+	if (xQueueSend(lanes[lane], &item, 0) != pdPASS) {
+		lane_item_t oldest;
+		if (xQueueReceive(lanes[lane], &oldest, 0) == pdPASS) {
+			free(oldest.body);
+			count_drop(lane);
+		}
+		if (xQueueSend(lanes[lane], &item, 0) != pdPASS) {
+			free(body);
+			count_drop(lane);
+			return;
+		}
 	}
-	osj_websocket_start();
-	is_restarting = false;
+	if (publisher_handle)
+		xTaskNotify(publisher_handle, PUB_BIT_WAKE, eSetBits);
 }
 
-void osj_websocket_send_status(int channel, int status,
-							   const char *device_type) {
-	if (!client || !esp_websocket_client_is_connected(client))
+static void lane_push_json(ws_lane_t lane, cJSON *root) {
+	char *body = cJSON_PrintUnformatted(root);
+	cJSON_Delete(root);
+	if (!body) {
+		count_drop(lane);
 		return;
+	}
+	lane_push(lane, body);
+}
 
-	osj_config_lock();
-	int device_id = (channel == 1) ? atoi(sys_config.ch1DeviceNo) : atoi(sys_config.ch2DeviceNo);
-	osj_config_unlock();
+// Safe to call from any task. Before the publisher exists the request is
+// dropped, because osj_websocket_start() queues its own restart.
+static uint32_t request_restart(void) {
+	portENTER_CRITICAL(&ctl_mux);
+	uint32_t ticket = ++restart_requested;
+	portEXIT_CRITICAL(&ctl_mux);
 
-	cJSON *root = cJSON_CreateObject();
-	cJSON_AddNumberToObject(root, "id", device_id);
-	cJSON_AddStringToObject(root, "device_type", device_type);
-	cJSON_AddNumberToObject(root, "state", status);
+	if (!ctl_queue)
+		return ticket;
 
-	char *json_str = cJSON_PrintUnformatted(root);
-	if (json_str) {
-		esp_websocket_client_send_text(client, json_str, strlen(json_str),
-									   100 / portTICK_PERIOD_MS);
-		free(json_str);
+	ctl_req_t req = {.ticket = ticket};
+	if (xQueueSend(ctl_queue, &req, 0) != pdPASS) {
+		// Queued requests collapse anyway, so the oldest can go.
+		ctl_req_t stale;
+		xQueueReceive(ctl_queue, &stale, 0);
+		xQueueSend(ctl_queue, &req, 0);
 	}
-	cJSON_Delete(root);
+	if (publisher_handle)
+		xTaskNotify(publisher_handle, PUB_BIT_WAKE, eSetBits);
+	return ticket;
+}
+
+// Frames stamped before the first SNTP sync carry "up" (ms since boot) or a
+// provisional "ts" with "tp":1. This tells the server how to fix both.
+static void on_first_time_sync(int64_t boot_utc_ms, int64_t shift_ms) {
+	size_t len = 80;
+	char *body = malloc(len);
+	if (body) {
+		snprintf(body, len,
+				 "{\"title\":\"TimeFix\",\"boot_utc_ms\":%" PRId64
+				 ",\"shift_ms\":%" PRId64 "}",
+				 boot_utc_ms, shift_ms);
+	}
+	lane_push(LANE_URGENT, body);
+}
+
+void osj_websocket_init(void) {
+	portENTER_CRITICAL(&ctl_mux);
+	bool first = !started;
+	started = true;
+	portEXIT_CRITICAL(&ctl_mux);
+
+	if (first) {
+		osj_ws_link_init();
+		next_seq = osj_nvs_get_uint("wsSeq", 0);
+		seq_reserved = next_seq;
+
+		lanes[LANE_URGENT] = xQueueCreate(CONFIG_OSJ_WS_URGENT_QUEUE_LEN,
+										  sizeof(lane_item_t));
+		lanes[LANE_BULK] =
+			xQueueCreate(CONFIG_OSJ_WS_BULK_QUEUE_LEN, sizeof(lane_item_t));
+		lanes[LANE_TELEMETRY] =
+			xQueueCreate(TELEMETRY_QUEUE_LEN, sizeof(lane_item_t));
+		ctl_queue = xQueueCreate(4, sizeof(ctl_req_t));
+		xTaskCreate(publisher_task, "ws_publisher", 4096, NULL, 5,
+					&publisher_handle);
+		osj_time_set_first_sync_cb(on_first_time_sync);
+	}
+}
+
+void osj_websocket_start(void) {
+	ESP_LOGI(TAG, "Starting %s link...", transport->name);
+	osj_websocket_init();
+	request_restart();
+}
+
+uint32_t osj_websocket_restart(void) {
+	if (!started) {
+		osj_websocket_start();
+		return restart_requested;
+	}
+	return request_restart();
+}
+
+bool osj_websocket_restart_done(uint32_t ticket) {
+	return (int32_t)(restart_applied - ticket) >= 0;
+}
+
+osj_ws_state_t osj_websocket_get_state(void) { return conn_state; }
+
+void osj_websocket_set_ack_observer(osj_websocket_ack_cb_t cb) {
+	ack_observer = cb;
+}
+
+void osj_websocket_flush(void) {
+	if (publisher_handle)
+		xTaskNotify(publisher_handle, PUB_BIT_FLUSH, eSetBits);
+}
+
+esp_err_t osj_websocket_register_command(const char *title,
+										 osj_websocket_cmd_handler_t handler) {
+	if (!title || !handler)
+		return ESP_ERR_INVALID_ARG;
+
+	// The publisher may already be dispatching, so the table is only
+	// touched under ctl_mux.
+	esp_err_t err = ESP_OK;
+	portENTER_CRITICAL(&ctl_mux);
+	if (command_count >= MAX_COMMANDS) {
+		err = ESP_ERR_NO_MEM;
+	} else {
+		commands[command_count].title = title;
+		commands[command_count].handler = handler;
+		command_count++;
+	}
+	portEXIT_CRITICAL(&ctl_mux);
+	return err;
+}
+
+void osj_websocket_send_status(int channel, int status,
+							   const char *device_type) {
+	// Stamped here because the frame may sit in the lane or the ACK window
+	// for a while before it reaches the server.
+	char stamp[48];
+	osj_time_format_stamp(stamp, sizeof(stamp));
+
+	// device_type is one of our own constants ("WASH"/"DRY"), no escaping.
+	const osj_ws_identity_t *id = osj_ws_identity_acquire();
+	const char *prefix = id->status_prefix[channel == 1 ? 0 : 1];
+	size_t len = strlen(prefix) + strlen(device_type) + strlen(stamp) + 40;
+	char *body = malloc(len);
+	if (body) {
+		snprintf(body, len, "%s\"device_type\":\"%s\",\"state\":%d,%s}",
+				 prefix, device_type, status, stamp);
+	}
+	osj_ws_identity_release(id);
+	lane_push(LANE_URGENT, body);
 }
 
 void osj_websocket_send_log(int channel, const char *log_json) {
-	if (!client || !esp_websocket_client_is_connected(client))
+	// Spliced into the frame as is, so anything but a JSON object would
+	// corrupt it. Log frames are rare enough to afford the parse.
+	cJSON *log = log_json ? cJSON_Parse(log_json) : NULL;
+	if (!cJSON_IsObject(log)) {
+		ESP_LOGW(TAG, "CH%d log is not a JSON object, sending empty log",
+				 channel);
+		log_json = "\"{}\"";
+	}
+	cJSON_Delete(log);
+
+	const osj_ws_identity_t *id = osj_ws_identity_acquire();
+	const char *prefix = id->log_prefix[channel == 1 ? 0 : 1];
+	size_t len = strlen(prefix) + strlen(log_json) + 2;
+	char *body = malloc(len);
+	if (body)
+		snprintf(body, len, "%s%s}", prefix, log_json);
+	osj_ws_identity_release(id);
+	lane_push(LANE_BULK, body);
+}
+
+#if CONFIG_OSJ_WS_TELEMETRY
+#define TELEMETRY_PERIOD_US (CONFIG_OSJ_WS_TELEMETRY_PERIOD_MS * 1000LL)
+#define TELEMETRY_KEYFRAME_US (CONFIG_OSJ_WS_TELEMETRY_KEYFRAME_S * 1000000LL)
+#define RMS_DEADBAND (CONFIG_OSJ_WS_TELEMETRY_RMS_DEADBAND_X100 / 100.0f)
+
+typedef struct {
+	int64_t next_sample_us;
+	int64_t last_key_us;
+	bool have_key;
+	float rms;
+	uint32_t flow;
+	int drain;
+	int rssi;
+} telemetry_state_t;
+
+// Last values actually sent, per channel. Only the laundry_core task calls
+// osj_websocket_send_telemetry(), so this needs no lock.
+static telemetry_state_t telemetry[2];
+static uint32_t telemetry_frames = 0;
+static uint32_t telemetry_skipped = 0;
+#endif
+
+void osj_websocket_send_telemetry(int channel, float rms, uint32_t flow_lph,
+								  int drain) {
+#if CONFIG_OSJ_WS_TELEMETRY
+	telemetry_state_t *st = &telemetry[channel == 1 ? 0 : 1];
+	int64_t now = esp_timer_get_time();
+	if (now < st->next_sample_us)
 		return;
+	st->next_sample_us = now + TELEMETRY_PERIOD_US;
+
+	int rssi = osj_wifi_is_connected() ? osj_wifi_get_rssi() : 0;
+	bool key = !st->have_key || now - st->last_key_us >= TELEMETRY_KEYFRAME_US;
 
-	osj_config_lock();
-	int device_id = (channel == 1) ? atoi(sys_config.ch1DeviceNo) : atoi(sys_config.ch2DeviceNo);
-	osj_config_unlock();
+	bool send_rms = key || fabsf(rms - st->rms) > RMS_DEADBAND;
+	bool send_flow =
+		key || abs((int)flow_lph - (int)st->flow) >
+				   CONFIG_OSJ_WS_TELEMETRY_FLOW_DEADBAND;
+	bool send_drain = key || drain != st->drain;
+	bool send_rssi =
+		key || abs(rssi - st->rssi) > CONFIG_OSJ_WS_TELEMETRY_RSSI_DEADBAND;
 
+	if (!send_rms && !send_flow && !send_drain && !send_rssi) {
+		telemetry_skipped++;
+		return;
+	}
+
+	char fields[112];
+	int len = snprintf(fields, sizeof(fields), "\"t\":%" PRId64,
+					   now / 1000);
+	if (key)
+		len += snprintf(fields + len, sizeof(fields) - len, ",\"key\":true");
+	if (send_rms) {
+		len += snprintf(fields + len, sizeof(fields) - len, ",\"rms\":%.2f",
+						rms);
+		st->rms = rms;
+	}
+	if (send_flow) {
+		len += snprintf(fields + len, sizeof(fields) - len, ",\"flow\":%" PRIu32,
+						flow_lph);
+		st->flow = flow_lph;
+	}
+	if (send_drain) {
+		len += snprintf(fields + len, sizeof(fields) - len, ",\"drain\":%d",
+						drain);
+		st->drain = drain;
+	}
+	if (send_rssi) {
+		snprintf(fields + len, sizeof(fields) - len, ",\"rssi\":%d", rssi);
+		st->rssi = rssi;
+	}
+	if (key) {
+		st->have_key = true;
+		st->last_key_us = now;
+	}
+
+	const osj_ws_identity_t *id = osj_ws_identity_acquire();
+	const char *prefix = id->status_prefix[channel == 1 ? 0 : 1];
+	size_t body_len = strlen(prefix) + strlen(fields) + 24;
+	char *body = malloc(body_len);
+	if (body) {
+		snprintf(body, body_len, "%s\"title\":\"Telemetry\",%s}", prefix,
+				 fields);
+	}
+	osj_ws_identity_release(id);
+	telemetry_frames++;
+	lane_push(LANE_TELEMETRY, body);
+#endif
+}
+
+char *osj_websocket_get_stats_json(void) {
 	cJSON *root = cJSON_CreateObject();
-	cJSON_AddStringToObject(root, "title", "Log");
-	cJSON_AddNumberToObject(root, "id", device_id);
 
-	cJSON *log_obj = cJSON_Parse(log_json);
-	if (log_obj) {
-		cJSON_AddItemToObject(root, "log", log_obj);
-	} else {
-		cJSON_AddStringToObject(root, "log", "{}");
+	cJSON *edges = cJSON_AddArrayToObject(root, "latency_le_ms");
+	for (size_t i = 0; i < LATENCY_BUCKETS - 1; i++) {
+		cJSON_AddItemToArray(edges, cJSON_CreateNumber(latency_edges_ms[i]));
 	}
 
-	char *json_str = cJSON_PrintUnformatted(root);
-	if (json_str) {
-		esp_websocket_client_send_text(client, json_str, strlen(json_str),
-									   100 / portTICK_PERIOD_MS);
-		free(json_str);
+	cJSON *lane_arr = cJSON_AddArrayToObject(root, "lanes");
+	for (int l = 0; l < LANE_COUNT; l++) {
+		cJSON *obj = cJSON_CreateObject();
+		cJSON_AddStringToObject(obj, "name", lane_names[l]);
+		cJSON_AddNumberToObject(obj, "sent", lane_sent[l]);
+		cJSON_AddNumberToObject(obj, "dropped", lane_dropped[l]);
+		cJSON_AddNumberToObject(obj, "acked", lane_acked[l]);
+		cJSON_AddNumberToObject(
+			obj, "queued", lanes[l] ? uxQueueMessagesWaiting(lanes[l]) : 0);
+		cJSON *hist = cJSON_AddArrayToObject(obj, "hist");
+		for (size_t i = 0; i < LATENCY_BUCKETS; i++) {
+			cJSON_AddItemToArray(hist, cJSON_CreateNumber(lane_hist[l][i]));
+		}
+		cJSON_AddItemToArray(lane_arr, obj);
 	}
+	cJSON_AddNumberToObject(root, "inflight", inflight_count);
+#if CONFIG_OSJ_WS_TELEMETRY
+	cJSON *tel = cJSON_AddObjectToObject(root, "telemetry");
+	cJSON_AddNumberToObject(tel, "frames", telemetry_frames);
+	cJSON_AddNumberToObject(tel, "skipped", telemetry_skipped);
+#endif
+	cJSON_AddItemToObject(root, "link", osj_ws_link_get_json());
+
+	char *json_str = cJSON_PrintUnformatted(root);
 	cJSON_Delete(root);
-}
\ No newline at end of file
+	return json_str;
+}
+
+cJSON *osj_websocket_get_link_json(void) {
+	cJSON *obj = osj_ws_link_get_json();
+	cJSON_AddStringToObject(obj, "state", state_names[conn_state]);
+	cJSON_AddNumberToObject(obj, "restart_requested", restart_requested);
+	cJSON_AddNumberToObject(obj, "restart_applied", restart_applied);
+	return obj;
+}
@@ -0,0 +1,150 @@
+#include "esp_crt_bundle.h"
+#include "esp_log.h"
+#include "mqtt_client.h"
+#include "osj_ws_link.h"
+#include "osj_ws_transport.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "OSJ_MQTT";
+
+// Topics are <prefix>/<room>/<hwid>/{up,cmd,status}. The device publishes
+// frames on "up" with QoS 1, listens on "cmd", and keeps a retained
+// online/offline flag on "status" through the last will.
+#define TOPIC_LEN 96
+
+// esp_mqtt_set_config() copies from these again when the reconnect delay
+// changes, so they have to outlive the client.
+static esp_mqtt_client_config_t mqtt_cfg;
+static char client_id[24];
+static char username[32];
+static char password[32];
+static char topic_up[TOPIC_LEN];
+static char topic_cmd[TOPIC_LEN];
+static char topic_status[TOPIC_LEN];
+
+static bool connected = false;
+static esp_websocket_error_type_t last_error = WEBSOCKET_ERROR_TYPE_NONE;
+
+static void mqtt_event_handler(void *handler_args, esp_event_base_t base,
+							   int32_t event_id, void *event_data) {
+	esp_mqtt_event_handle_t event = event_data;
+
+	switch ((esp_mqtt_event_id_t)event_id) {
+	case MQTT_EVENT_BEFORE_CONNECT:
+		osj_ws_link_on_before_connect();
+		break;
+	case MQTT_EVENT_CONNECTED:
+		ESP_LOGI(TAG, "MQTT_EVENT_CONNECTED");
+		connected = true;
+		last_error = WEBSOCKET_ERROR_TYPE_NONE;
+		osj_ws_link_on_connected();
+		esp_mqtt_client_publish(event->client, topic_status, "online", 0, 1,
+								1);
+		osj_ws_transport_on_connected(event->client);
+		break;
+	case MQTT_EVENT_DISCONNECTED:
+		ESP_LOGI(TAG, "MQTT_EVENT_DISCONNECTED");
+		connected = false;
+		// Same backoff policy as the websocket backend. The client reads
+		// the reconnect delay from its config before the next attempt.
+		mqtt_cfg.network.reconnect_timeout_ms =
+			osj_ws_link_on_disconnected(last_error);
+		esp_mqtt_set_config(event->client, &mqtt_cfg);
+		osj_ws_transport_on_disconnected(event->client);
+		break;
+	case MQTT_EVENT_DATA:
+		// Commands are small; messages split over several events are
+		// not reassembled.
+		if (event->current_data_offset == 0 &&
+			event->data_len == event->total_data_len &&
+			event->topic_len == (int)strlen(topic_cmd) &&
+			strncmp(event->topic, topic_cmd, event->topic_len) == 0) {
+			osj_ws_transport_on_message(event->client, event->data,
+										event->data_len);
+		}
+		break;
+	case MQTT_EVENT_ERROR:
+		if (event->error_handle->error_type == MQTT_ERROR_TYPE_TCP_TRANSPORT)
+			last_error = WEBSOCKET_ERROR_TYPE_TCP_TRANSPORT;
+		else if (event->error_handle->error_type ==
+				 MQTT_ERROR_TYPE_CONNECTION_REFUSED)
+			last_error = WEBSOCKET_ERROR_TYPE_HANDSHAKE;
+		ESP_LOGI(TAG, "MQTT_EVENT_ERROR (type %d)",
+				 event->error_handle->error_type);
+		break;
+	default:
+		break;
+	}
+}
+
+static void *mqtt_connect(const osj_ws_identity_t *id) {
+	snprintf(client_id, sizeof(client_id), "lotura-%d", id->device_id[0]);
+	strlcpy(username, id->auth_id, sizeof(username));
+	strlcpy(password, id->auth_pass, sizeof(password));
+	snprintf(topic_up, sizeof(topic_up), "%s/%s/%d/up",
+			 CONFIG_OSJ_MQTT_TOPIC_PREFIX, id->room, id->device_id[0]);
+	snprintf(topic_cmd, sizeof(topic_cmd), "%s/%s/%d/cmd",
+			 CONFIG_OSJ_MQTT_TOPIC_PREFIX, id->room, id->device_id[0]);
+	snprintf(topic_status, sizeof(topic_status), "%s/%s/%d/status",
+			 CONFIG_OSJ_MQTT_TOPIC_PREFIX, id->room, id->device_id[0]);
+
+	memset(&mqtt_cfg, 0, sizeof(mqtt_cfg));
+	mqtt_cfg.broker.address.uri = CONFIG_OSJ_MQTT_URI;
+	mqtt_cfg.broker.verification.crt_bundle_attach = esp_crt_bundle_attach;
+	mqtt_cfg.credentials.client_id = client_id;
+	mqtt_cfg.credentials.username = username[0] ? username : NULL;
+	mqtt_cfg.credentials.authentication.password =
+		password[0] ? password : NULL;
+	mqtt_cfg.session.keepalive = 10;
+	mqtt_cfg.session.last_will.topic = topic_status;
+	mqtt_cfg.session.last_will.msg = "offline";
+	mqtt_cfg.session.last_will.qos = 1;
+	mqtt_cfg.session.last_will.retain = 1;
+	mqtt_cfg.network.timeout_ms = 10000;
+	mqtt_cfg.network.reconnect_timeout_ms = CONFIG_OSJ_WS_BACKOFF_BASE_MS;
+
+	esp_mqtt_client_handle_t client = esp_mqtt_client_init(&mqtt_cfg);
+	if (!client)
+		return NULL;
+	connected = false;
+	last_error = WEBSOCKET_ERROR_TYPE_NONE;
+	esp_mqtt_client_register_event(client, ESP_EVENT_ANY_ID,
+								   mqtt_event_handler, NULL);
+	esp_mqtt_client_start(client);
+	return client;
+}
+
+static void mqtt_disconnect(void *session) {
+	if (!session)
+		return;
+	ESP_LOGI(TAG, "Stopping MQTT Client for restart...");
+	esp_mqtt_client_stop(session);
+	esp_mqtt_client_destroy(session);
+	connected = false;
+}
+
+// The publisher's seq/Ack window already gives end-to-end delivery; QoS 1
+// additionally lets the broker absorb short drops on its side.
+static int mqtt_publish(void *session, const char *frame, size_t len,
+						int timeout_ms) {
+	return esp_mqtt_client_publish(session, topic_up, frame, len, 1, 0);
+}
+
+static esp_err_t mqtt_subscribe(void *session, const char *channel) {
+	if (strcmp(channel, "cmd") != 0)
+		return ESP_ERR_NOT_SUPPORTED;
+	return esp_mqtt_client_subscribe(session, topic_cmd, 1) < 0 ? ESP_FAIL
+																 : ESP_OK;
+}
+
+static bool mqtt_is_connected(void *session) { return session && connected; }
+
+const osj_ws_transport_t osj_ws_transport_mqtt = {
+	.name = "mqtt",
+	.connect = mqtt_connect,
+	.disconnect = mqtt_disconnect,
+	.publish = mqtt_publish,
+	.subscribe = mqtt_subscribe,
+	.is_connected = mqtt_is_connected,
+};
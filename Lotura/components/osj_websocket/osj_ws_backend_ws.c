@@ -0,0 +1,156 @@
+#include "esp_log.h"
+#include "esp_transport_ws.h"
+#include "esp_websocket_client.h"
+#include "freertos/FreeRTOS.h"
+#include "osj_ws_link.h"
+#include "osj_ws_transport.h"
+#include <stdint.h>
+#include <string.h>
+#if CONFIG_OSJ_WS_TLS
+#include "esp_crt_bundle.h"
+#include "osj_ws_tls.h"
+#endif
+
+static const char *TAG = "OSJ_WS";
+
+// wss:// connections run over our own TLS transport so the TLS session can
+// be resumed. The client does not free an external transport, so we do.
+static esp_transport_handle_t tls_transport = NULL;
+static esp_transport_handle_t ws_transport = NULL;
+
+static void websocket_event_handler(void *handler_args, esp_event_base_t base,
+									int32_t event_id, void *event_data) {
+	esp_websocket_event_data_t *data = (esp_websocket_event_data_t *)event_data;
+	int client_num = (int)(intptr_t)handler_args;
+
+	switch (event_id) {
+	case WEBSOCKET_EVENT_BEFORE_CONNECT:
+		osj_ws_link_on_before_connect();
+		break;
+	case WEBSOCKET_EVENT_CONNECTED:
+		ESP_LOGI(TAG, "Client %d: WEBSOCKET_EVENT_CONNECTED", client_num);
+		osj_ws_link_on_connected();
+		osj_ws_transport_on_connected(data->client);
+		break;
+	case WEBSOCKET_EVENT_DISCONNECTED:
+		ESP_LOGI(TAG, "Client %d: WEBSOCKET_EVENT_DISCONNECTED", client_num);
+		// The library reads the reconnect timeout on every wait iteration,
+		// so setting it here applies to the reconnect that follows.
+		esp_websocket_client_set_reconnect_timeout(
+			data->client,
+			osj_ws_link_on_disconnected(data->error_handle.error_type));
+		osj_ws_transport_on_disconnected(data->client);
+		break;
+	case WEBSOCKET_EVENT_DATA:
+		// Commands are small; fragmented frames are not reassembled.
+		if (data->op_code == WS_TRANSPORT_OPCODES_TEXT &&
+			data->payload_offset == 0 && data->data_len == data->payload_len) {
+			osj_ws_transport_on_message(data->client, data->data_ptr,
+										data->data_len);
+		}
+		break;
+	case WEBSOCKET_EVENT_ERROR:
+		ESP_LOGI(TAG, "Client: WEBSOCKET_EVENT_ERROR");
+		break;
+	}
+}
+
+static void destroy_wss_transport(void) {
+	if (ws_transport) {
+		esp_transport_destroy(ws_transport);
+		ws_transport = NULL;
+	}
+	if (tls_transport) {
+		esp_transport_destroy(tls_transport);
+		tls_transport = NULL;
+	}
+}
+
+#if CONFIG_OSJ_WS_TLS
+static esp_transport_handle_t create_wss_transport(const char *headers) {
+	// The client only configures transports it creates itself, so the
+	// upgrade path and headers have to be set on ours here.
+	const char *path = strchr(CONFIG_OSJ_WS_URI + 6, '/');
+
+	tls_transport = osj_ws_tls_transport_init();
+	if (tls_transport)
+		ws_transport = esp_transport_ws_init(tls_transport);
+	if (!ws_transport) {
+		ESP_LOGE(TAG, "Failed to create wss transport");
+		destroy_wss_transport();
+		return NULL;
+	}
+
+	esp_transport_ws_config_t ws_cfg = {
+		.ws_path = path ? path : "/",
+		.headers = headers,
+		.propagate_control_frames = true,
+	};
+	esp_transport_ws_set_config(ws_transport, &ws_cfg);
+	esp_transport_set_default_port(ws_transport, 443);
+	return ws_transport;
+}
+#endif
+
+static void *ws_connect(const osj_ws_identity_t *id) {
+	// The client and transport copy the headers, so a later rebuild of the
+	// identity does not affect a running connection.
+	esp_websocket_client_config_t websocket_cfg = {};
+	websocket_cfg.uri = CONFIG_OSJ_WS_URI;
+	websocket_cfg.headers = id->headers;
+	websocket_cfg.network_timeout_ms = 10000;
+	websocket_cfg.reconnect_timeout_ms = CONFIG_OSJ_WS_BACKOFF_BASE_MS;
+	websocket_cfg.ping_interval_sec = 10;
+
+#if CONFIG_OSJ_WS_TLS
+	websocket_cfg.crt_bundle_attach = esp_crt_bundle_attach;
+
+	if (strncmp(CONFIG_OSJ_WS_URI, "wss://", 6) == 0) {
+		websocket_cfg.ext_transport = create_wss_transport(id->headers);
+	}
+#endif
+
+	esp_websocket_client_handle_t new_client =
+		esp_websocket_client_init(&websocket_cfg);
+	if (!new_client) {
+		destroy_wss_transport();
+		return NULL;
+	}
+	esp_websocket_register_events(new_client, WEBSOCKET_EVENT_ANY,
+								  websocket_event_handler, (void *)0);
+	esp_websocket_client_start(new_client);
+	return new_client;
+}
+
+static void ws_disconnect(void *session) {
+	if (session) {
+		ESP_LOGI(TAG, "Stopping WebSocket Client for restart...");
+		esp_websocket_client_stop(session);
+		esp_websocket_client_destroy(session);
+	}
+	destroy_wss_transport();
+}
+
+static int ws_publish(void *session, const char *frame, size_t len,
+					  int timeout_ms) {
+	return esp_websocket_client_send_text(session, frame, len,
+										  pdMS_TO_TICKS(timeout_ms));
+}
+
+// Every message arrives on the one socket, so there is nothing to join.
+static esp_err_t ws_subscribe(void *session, const char *channel) {
+	return ESP_OK;
+}
+
+static bool ws_is_connected(void *session) {
+	return session && esp_websocket_client_is_connected(session);
+}
+
+const osj_ws_transport_t osj_ws_transport_websocket = {
+	.name = "websocket",
+	.connect = ws_connect,
+	.disconnect = ws_disconnect,
+	.publish = ws_publish,
+	.subscribe = ws_subscribe,
+	.is_connected = ws_is_connected,
+};
@@ -0,0 +1,92 @@
+#include "osj_ws_identity.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "mbedtls/base64.h"
+#include "osj_config.h"
+#include "osj_snapshot.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "OSJ_WS_ID";
+
+// Readers borrow the published entry through osj_snapshot, so a rebuild
+// waits for them instead of overwriting an entry still in use.
+static osj_ws_identity_t slot_a, slot_b;
+static osj_snapshot_t snap = {.slot = {&slot_a, &slot_b},
+							  .size = sizeof(osj_ws_identity_t)};
+static osj_ws_identity_t next; // only touched by the rebuilding task
+static volatile uint32_t built_generation = 0;
+static volatile bool built = false;
+
+static portMUX_TYPE rebuild_mux = portMUX_INITIALIZER_UNLOCKED;
+static volatile bool rebuilding = false;
+
+static void build(osj_ws_identity_t *id) {
+	const SystemConfig *cfg = osj_config_acquire();
+	id->device_id[0] = atoi(cfg->ch1DeviceNo);
+	id->device_id[1] = atoi(cfg->ch2DeviceNo);
+	strlcpy(id->auth_id, cfg->authId, sizeof(id->auth_id));
+	strlcpy(id->auth_pass, cfg->authPasswd, sizeof(id->auth_pass));
+	strlcpy(id->room, cfg->roomNo, sizeof(id->room));
+	osj_config_release(cfg);
+
+	id->registered = id->device_id[0] != 1;
+
+	char auth_str[sizeof(id->auth_id) + sizeof(id->auth_pass) + 1];
+	snprintf(auth_str, sizeof(auth_str), "%s:%s", id->auth_id, id->auth_pass);
+	unsigned char auth_b64[100];
+	size_t out_len = 0;
+	mbedtls_base64_encode(auth_b64, sizeof(auth_b64), &out_len,
+						  (unsigned char *)auth_str, strlen(auth_str));
+	auth_b64[out_len] = '\0';
+
+	snprintf(id->headers, sizeof(id->headers),
+			 "Authorization: Basic %s\r\n"
+			 "HWID: %d\r\n"
+			 "ROOM: %s\r\n",
+			 auth_b64, id->device_id[0], id->room);
+
+	for (int ch = 0; ch < 2; ch++) {
+		snprintf(id->status_prefix[ch], sizeof(id->status_prefix[ch]),
+				 "{\"id\":%d,", id->device_id[ch]);
+		snprintf(id->log_prefix[ch], sizeof(id->log_prefix[ch]),
+				 "{\"title\":\"Log\",\"id\":%d,\"log\":", id->device_id[ch]);
+	}
+}
+
+static void refresh(void) {
+	uint32_t gen = osj_config_generation();
+	if (built && built_generation == gen)
+		return;
+
+	// One task rebuilds; the others keep using the previous entry.
+	portENTER_CRITICAL(&rebuild_mux);
+	bool mine = !rebuilding;
+	rebuilding = true;
+	portEXIT_CRITICAL(&rebuild_mux);
+	if (!mine) {
+		while (!built)
+			vTaskDelay(1);
+		return;
+	}
+
+	build(&next);
+	osj_snapshot_publish(&snap, &next);
+	built_generation = gen;
+	built = true;
+	rebuilding = false;
+	ESP_LOGI(TAG, "Identity rebuilt (ch1=%d, ch2=%d)", next.device_id[0],
+			 next.device_id[1]);
+}
+
+const osj_ws_identity_t *osj_ws_identity_acquire(void) {
+	refresh();
+	return osj_snapshot_acquire(&snap);
+}
+
+void osj_ws_identity_release(const osj_ws_identity_t *id) {
+	osj_snapshot_release(&snap, id);
+}
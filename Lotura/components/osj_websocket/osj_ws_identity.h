@@ -0,0 +1,35 @@
+#ifndef OSJ_WS_IDENTITY_H
+#define OSJ_WS_IDENTITY_H
+
+#include <stdbool.h>
+
+/**
+ * @brief 설정에서 만든 기기 식별 정보 묶음.
+ * @details 설정이 바뀔 때만 다시 만들어지며, osj_snapshot으로 잠금 없이 읽는다.
+ */
+typedef struct {
+	int device_id[2];
+	bool registered;
+	char auth_id[32];
+	char auth_pass[32];
+	char room[16];
+	char headers[256];
+	char status_prefix[2][24];
+	char log_prefix[2][40];
+} osj_ws_identity_t;
+
+/**
+ * @brief 현재 설정에 맞는 식별 정보를 빌린다.
+ * @details 설정 세대(osj_config_generation)가 바뀌었을 때만 설정을 빌려
+ * 다시 만든다. 평소에는 문자열 파싱을 하지 않는다. 빌린 동안 내용은
+ * 바뀌지 않으며, 다시 만드는 쪽이 기다리므로 빌린 채로 블로킹하지 않는다.
+ * @return osj_ws_identity_release()로 돌려줘야 하는 식별 정보
+ */
+const osj_ws_identity_t *osj_ws_identity_acquire(void);
+
+/**
+ * @brief osj_ws_identity_acquire()로 빌린 식별 정보를 돌려준다.
+ */
+void osj_ws_identity_release(const osj_ws_identity_t *id);
+
+#endif
@@ -0,0 +1,163 @@
+#include "osj_ws_link.h"
+#include "esp_log.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+static const char *TAG = "OSJ_WS_LINK";
+
+#define BACKOFF_BASE_MS CONFIG_OSJ_WS_BACKOFF_BASE_MS
+#define BACKOFF_CAP_MS CONFIG_OSJ_WS_BACKOFF_CAP_MS
+#define BACKOFF_MIN_MS 100
+
+// A session that lasted this long resets the backoff. Shorter ones count as
+// flapping and keep growing the delay.
+#define STABLE_SESSION_US (30 * 1000000LL)
+
+static const char *const reason_names[] = {"none", "tcp", "pong_timeout",
+										   "handshake", "server_close"};
+#define REASON_COUNT (sizeof(reason_names) / sizeof(reason_names[0]))
+
+static portMUX_TYPE link_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static uint32_t backoff_attempt = 0;
+static uint32_t last_delay_ms = 0;
+
+static int64_t started_us = 0;
+static int64_t attempt_start_us = 0;
+static int64_t connected_since_us = 0;
+static int64_t connected_total_us = 0;
+
+static uint32_t connects = 0;
+static uint32_t attempts = 0;
+static uint32_t last_connect_ms = 0;
+static uint32_t last_handshake_ms = 0;
+static bool last_handshake_resumed = false;
+static uint64_t connect_ms_sum = 0;
+
+// Index 0: full handshake, 1: session offered for resumption.
+static uint64_t handshake_ms_sum[2];
+static uint32_t handshake_samples[2];
+static uint32_t disconnects[REASON_COUNT];
+
+void osj_ws_link_init(void) {
+	portENTER_CRITICAL(&link_mux);
+	if (started_us == 0)
+		started_us = esp_timer_get_time();
+	portEXIT_CRITICAL(&link_mux);
+}
+
+void osj_ws_link_on_before_connect(void) {
+	portENTER_CRITICAL(&link_mux);
+	attempt_start_us = esp_timer_get_time();
+	attempts++;
+	portEXIT_CRITICAL(&link_mux);
+}
+
+void osj_ws_link_on_tls_handshake(uint32_t handshake_ms, bool resumed) {
+	portENTER_CRITICAL(&link_mux);
+	last_handshake_ms = handshake_ms;
+	last_handshake_resumed = resumed;
+	handshake_ms_sum[resumed ? 1 : 0] += handshake_ms;
+	handshake_samples[resumed ? 1 : 0]++;
+	portEXIT_CRITICAL(&link_mux);
+}
+
+void osj_ws_link_on_connected(void) {
+	portENTER_CRITICAL(&link_mux);
+	int64_t now = esp_timer_get_time();
+	if (attempt_start_us != 0) {
+		last_connect_ms = (uint32_t)((now - attempt_start_us) / 1000);
+		connect_ms_sum += last_connect_ms;
+	}
+	connected_since_us = now;
+	connects++;
+	portEXIT_CRITICAL(&link_mux);
+	ESP_LOGI(TAG, "Connected in %" PRIu32 " ms (handshake %" PRIu32 " ms, %s)",
+			 last_connect_ms, last_handshake_ms,
+			 last_handshake_resumed ? "resumed" : "full");
+}
+
+int osj_ws_link_on_disconnected(esp_websocket_error_type_t reason) {
+	uint32_t jitter = esp_random();
+
+	portENTER_CRITICAL(&link_mux);
+	int64_t now = esp_timer_get_time();
+	if (connected_since_us != 0) {
+		int64_t session_us = now - connected_since_us;
+		connected_total_us += session_us;
+		connected_since_us = 0;
+		if (session_us >= STABLE_SESSION_US)
+			backoff_attempt = 0;
+	}
+	if ((unsigned)reason < REASON_COUNT)
+		disconnects[reason]++;
+
+	// Full jitter: uniform in [0, min(cap, base * 2^attempt)].
+	uint32_t ceiling = BACKOFF_CAP_MS;
+	if (backoff_attempt < 16 &&
+		((uint32_t)BACKOFF_BASE_MS << backoff_attempt) < BACKOFF_CAP_MS)
+		ceiling = (uint32_t)BACKOFF_BASE_MS << backoff_attempt;
+	backoff_attempt++;
+
+	uint32_t delay = jitter % (ceiling + 1);
+	if (delay < BACKOFF_MIN_MS)
+		delay = BACKOFF_MIN_MS;
+	last_delay_ms = delay;
+	portEXIT_CRITICAL(&link_mux);
+
+	ESP_LOGI(TAG, "Disconnected (%s), reconnect in %" PRIu32
+			 " ms (attempt %" PRIu32 ")",
+			 ((unsigned)reason < REASON_COUNT) ? reason_names[reason] : "?",
+			 delay, backoff_attempt);
+	return (int)delay;
+}
+
+cJSON *osj_ws_link_get_json(void) {
+	portENTER_CRITICAL(&link_mux);
+	int64_t now = esp_timer_get_time();
+	int64_t up_us = connected_total_us;
+	if (connected_since_us != 0)
+		up_us += now - connected_since_us;
+	int64_t span_us = (started_us != 0) ? now - started_us : 0;
+	uint32_t conn = connects, att = attempts, backoff = backoff_attempt;
+	uint32_t last_conn = last_connect_ms, last_hs = last_handshake_ms;
+	uint32_t delay = last_delay_ms;
+	uint64_t conn_sum = connect_ms_sum;
+	uint64_t hs_sum[2] = {handshake_ms_sum[0], handshake_ms_sum[1]};
+	uint32_t hs_n[2] = {handshake_samples[0], handshake_samples[1]};
+	bool hs_resumed = last_handshake_resumed;
+	bool up = connected_since_us != 0;
+	uint32_t reasons[REASON_COUNT];
+	for (size_t i = 0; i < REASON_COUNT; i++)
+		reasons[i] = disconnects[i];
+	portEXIT_CRITICAL(&link_mux);
+
+	cJSON *obj = cJSON_CreateObject();
+	cJSON_AddBoolToObject(obj, "connected", up);
+	cJSON_AddNumberToObject(obj, "uptime_ratio",
+							span_us > 0 ? (double)up_us / span_us : 0);
+	cJSON_AddNumberToObject(obj, "attempts", att);
+	cJSON_AddNumberToObject(obj, "connects", conn);
+	cJSON_AddNumberToObject(obj, "backoff_attempt", backoff);
+	cJSON_AddNumberToObject(obj, "next_delay_ms", delay);
+	cJSON_AddNumberToObject(obj, "connect_ms", last_conn);
+	cJSON_AddNumberToObject(obj, "connect_ms_avg",
+							conn ? (double)conn_sum / conn : 0);
+	cJSON_AddNumberToObject(obj, "handshake_ms", last_hs);
+	cJSON_AddBoolToObject(obj, "handshake_resumed", hs_resumed);
+	cJSON_AddNumberToObject(obj, "handshake_full_n", hs_n[0]);
+	cJSON_AddNumberToObject(obj, "handshake_full_ms_avg",
+							hs_n[0] ? (double)hs_sum[0] / hs_n[0] : 0);
+	cJSON_AddNumberToObject(obj, "handshake_resumed_n", hs_n[1]);
+	cJSON_AddNumberToObject(obj, "handshake_resumed_ms_avg",
+							hs_n[1] ? (double)hs_sum[1] / hs_n[1] : 0);
+
+	cJSON *disc = cJSON_AddObjectToObject(obj, "disconnects");
+	for (size_t i = 0; i < REASON_COUNT; i++)
+		cJSON_AddNumberToObject(disc, reason_names[i], reasons[i]);
+	return obj;
+}
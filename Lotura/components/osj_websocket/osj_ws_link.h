@@ -0,0 +1,44 @@
+#ifndef OSJ_WS_LINK_H
+#define OSJ_WS_LINK_H
+
+#include "cJSON.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_websocket_client.h"
+
+/**
+ * @brief 재연결 컨트롤러와 링크 품질 통계를 초기화한다.
+ */
+void osj_ws_link_init(void);
+
+/**
+ * @brief 연결 시도 직전(WEBSOCKET_EVENT_BEFORE_CONNECT)에 호출한다.
+ */
+void osj_ws_link_on_before_connect(void);
+
+/**
+ * @brief TLS 전송 계층이 연결(TCP+TLS 핸드셰이크)을 마쳤을 때 호출한다.
+ * @param handshake_ms 연결에 걸린 시간 (ms)
+ * @param resumed 제시한 세션을 서버가 받아들여 재개했으면 true
+ */
+void osj_ws_link_on_tls_handshake(uint32_t handshake_ms, bool resumed);
+
+/**
+ * @brief 연결 성공(WEBSOCKET_EVENT_CONNECTED) 시 호출한다.
+ */
+void osj_ws_link_on_connected(void);
+
+/**
+ * @brief 연결 끊김(WEBSOCKET_EVENT_DISCONNECTED) 시 호출한다.
+ * @param reason 라이브러리가 보고한 끊김 원인
+ * @return 다음 재연결까지 대기할 시간 (ms, 지수 백오프 + full jitter)
+ */
+int osj_ws_link_on_disconnected(esp_websocket_error_type_t reason);
+
+/**
+ * @brief 링크 품질 통계를 cJSON 객체로 반환한다.
+ * @return cJSON 객체 (호출자가 cJSON_Delete 또는 다른 객체에 추가해야 함)
+ */
+cJSON *osj_ws_link_get_json(void);
+
+#endif
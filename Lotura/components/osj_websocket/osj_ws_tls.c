@@ -0,0 +1,303 @@
+#include "osj_ws_tls.h"
+#include "esp_crt_bundle.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_tls.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/net_sockets.h"
+#include "mbedtls/ssl.h"
+#include "osj_ws_link.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/select.h>
+#if CONFIG_OSJ_WS_TLS_SESSION_RTC
+#include "esp_attr.h"
+#include "esp_rom_crc.h"
+#endif
+
+static const char *TAG = "OSJ_WS_TLS";
+
+// esp-tls only hands sessions out as an opaque esp_tls_client_session_t that
+// cannot be rebuilt from saved bytes, so the handshake runs on mbedtls
+// directly over esp-tls's plain TCP connect. The session is then an ordinary
+// mbedtls_ssl_session that the public save/load calls can serialize.
+typedef struct {
+	mbedtls_ssl_context ssl;
+	mbedtls_ssl_config conf;
+	mbedtls_net_context net;
+	bool open;
+} tls_ctx_t;
+
+// Only the websocket client task connects, so no lock is needed.
+static mbedtls_entropy_context entropy;
+static mbedtls_ctr_drbg_context drbg;
+static bool drbg_ready = false;
+static mbedtls_ssl_session cached_session;
+static bool have_session = false;
+
+#if CONFIG_OSJ_WS_TLS_SESSION_RTC
+#define RTC_SESSION_MAGIC 0x4f534a53
+#define RTC_SESSION_MAX 2048
+
+typedef struct {
+	uint32_t magic;
+	uint32_t len;
+	uint32_t crc;
+	uint8_t data[RTC_SESSION_MAX];
+} rtc_session_t;
+
+static RTC_NOINIT_ATTR rtc_session_t rtc_session;
+
+static void rtc_session_save(void) {
+	size_t len = 0;
+	rtc_session.magic = 0;
+	if (mbedtls_ssl_session_save(&cached_session, rtc_session.data,
+								 sizeof(rtc_session.data), &len) == 0) {
+		rtc_session.len = len;
+		rtc_session.crc = esp_rom_crc32_le(0, rtc_session.data, len);
+		rtc_session.magic = RTC_SESSION_MAGIC;
+	}
+}
+
+static void rtc_session_load(void) {
+	if (rtc_session.magic != RTC_SESSION_MAGIC ||
+		rtc_session.len > sizeof(rtc_session.data) ||
+		esp_rom_crc32_le(0, rtc_session.data, rtc_session.len) !=
+			rtc_session.crc)
+		return;
+
+	mbedtls_ssl_session_init(&cached_session);
+	if (mbedtls_ssl_session_load(&cached_session, rtc_session.data,
+								 rtc_session.len) != 0) {
+		mbedtls_ssl_session_free(&cached_session);
+		rtc_session.magic = 0;
+		return;
+	}
+	have_session = true;
+	ESP_LOGI(TAG, "Restored TLS session from RTC memory");
+}
+#endif
+
+static void forget_session(void) {
+	if (have_session) {
+		mbedtls_ssl_session_free(&cached_session);
+		have_session = false;
+	}
+#if CONFIG_OSJ_WS_TLS_SESSION_RTC
+	rtc_session.magic = 0;
+#endif
+}
+
+// A resumed TLS 1.2 handshake keeps the offered session's master secret; a
+// full one derives a new one. Comparing session IDs is not enough because
+// mbedtls sends a fresh random ID alongside a ticket.
+//
+// mbedtls 3.x has no public accessor for this: `master` is a private field
+// reached through MBEDTLS_PRIVATE() and may move or disappear in a later
+// mbedtls release. If it does, this stops compiling rather than misreporting;
+// the only fallback is to report every handshake as full.
+static bool session_resumed(const mbedtls_ssl_session *fresh) {
+#if defined(MBEDTLS_SSL_PROTO_TLS1_2)
+	return memcmp(fresh->MBEDTLS_PRIVATE(master),
+				  cached_session.MBEDTLS_PRIVATE(master),
+				  sizeof(fresh->MBEDTLS_PRIVATE(master))) == 0;
+#else
+	return false;
+#endif
+}
+
+static int tls_poll(int fd, int timeout_ms, bool for_write) {
+	fd_set set, errset;
+	FD_ZERO(&set);
+	FD_ZERO(&errset);
+	FD_SET(fd, &set);
+	FD_SET(fd, &errset);
+
+	struct timeval tv = {.tv_sec = timeout_ms / 1000,
+						 .tv_usec = (timeout_ms % 1000) * 1000};
+	int ret = select(fd + 1, for_write ? NULL : &set, for_write ? &set : NULL,
+					 &errset, timeout_ms < 0 ? NULL : &tv);
+	if (ret > 0 && FD_ISSET(fd, &errset))
+		return -1;
+	return ret;
+}
+
+static void tls_free(tls_ctx_t *ctx) {
+	mbedtls_ssl_free(&ctx->ssl);
+	mbedtls_ssl_config_free(&ctx->conf);
+	mbedtls_net_free(&ctx->net);
+	ctx->open = false;
+}
+
+static int tls_handshake(tls_ctx_t *ctx, const char *host) {
+	int ret;
+	if ((ret = mbedtls_ssl_config_defaults(&ctx->conf, MBEDTLS_SSL_IS_CLIENT,
+										   MBEDTLS_SSL_TRANSPORT_STREAM,
+										   MBEDTLS_SSL_PRESET_DEFAULT)) != 0)
+		return ret;
+	mbedtls_ssl_conf_authmode(&ctx->conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+	mbedtls_ssl_conf_rng(&ctx->conf, mbedtls_ctr_drbg_random, &drbg);
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+	mbedtls_ssl_conf_session_tickets(&ctx->conf,
+									 MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#endif
+	if (esp_crt_bundle_attach(&ctx->conf) != ESP_OK)
+		return -1;
+	if ((ret = mbedtls_ssl_setup(&ctx->ssl, &ctx->conf)) != 0 ||
+		(ret = mbedtls_ssl_set_hostname(&ctx->ssl, host)) != 0)
+		return ret;
+	if (have_session && mbedtls_ssl_set_session(&ctx->ssl, &cached_session) != 0)
+		forget_session();
+	mbedtls_ssl_set_bio(&ctx->ssl, &ctx->net, mbedtls_net_send,
+						mbedtls_net_recv, NULL);
+
+	while ((ret = mbedtls_ssl_handshake(&ctx->ssl)) != 0) {
+		if (ret != MBEDTLS_ERR_SSL_WANT_READ &&
+			ret != MBEDTLS_ERR_SSL_WANT_WRITE)
+			return ret;
+	}
+	return 0;
+}
+
+static int tls_connect(esp_transport_handle_t t, const char *host, int port,
+					   int timeout_ms) {
+	tls_ctx_t *ctx = esp_transport_get_context_data(t);
+
+	if (!drbg_ready) {
+		mbedtls_entropy_init(&entropy);
+		mbedtls_ctr_drbg_init(&drbg);
+		if (mbedtls_ctr_drbg_seed(&drbg, mbedtls_entropy_func, &entropy, NULL,
+								  0) != 0)
+			return ERR_TCP_TRANSPORT_CONNECTION_FAILED;
+		drbg_ready = true;
+	}
+#if CONFIG_OSJ_WS_TLS_SESSION_RTC
+	if (!have_session)
+		rtc_session_load();
+#endif
+
+	mbedtls_ssl_init(&ctx->ssl);
+	mbedtls_ssl_config_init(&ctx->conf);
+	mbedtls_net_init(&ctx->net);
+	ctx->open = true;
+
+	int64_t start = esp_timer_get_time();
+	esp_tls_cfg_t cfg = {.timeout_ms = timeout_ms};
+	esp_tls_last_error_t tcp_err = {0};
+	int ret = -1;
+	if (esp_tls_plain_tcp_connect(host, strlen(host), port, &cfg, &tcp_err,
+								  &ctx->net.fd) == ESP_OK)
+		ret = tls_handshake(ctx, host);
+	if (ret != 0) {
+		ESP_LOGW(TAG, "TLS connect to %s:%d failed (-0x%x)", host, port,
+				 (unsigned)-ret);
+		tls_free(ctx);
+		forget_session();
+		return ERR_TCP_TRANSPORT_CONNECTION_FAILED;
+	}
+
+	bool offered = have_session;
+	bool resumed = false;
+	mbedtls_ssl_session fresh;
+	mbedtls_ssl_session_init(&fresh);
+	if (mbedtls_ssl_get_session(&ctx->ssl, &fresh) == 0) {
+		resumed = offered && session_resumed(&fresh);
+		if (offered)
+			mbedtls_ssl_session_free(&cached_session);
+		cached_session = fresh;
+		have_session = true;
+#if CONFIG_OSJ_WS_TLS_SESSION_RTC
+		rtc_session_save();
+#endif
+	} else {
+		mbedtls_ssl_session_free(&fresh);
+	}
+	osj_ws_link_on_tls_handshake(
+		(uint32_t)((esp_timer_get_time() - start) / 1000), resumed);
+	return 0;
+}
+
+static int tls_poll_read(esp_transport_handle_t t, int timeout_ms) {
+	tls_ctx_t *ctx = esp_transport_get_context_data(t);
+	if (!ctx->open)
+		return -1;
+	if (mbedtls_ssl_get_bytes_avail(&ctx->ssl) > 0)
+		return 1;
+	return tls_poll(ctx->net.fd, timeout_ms, false);
+}
+
+static int tls_poll_write(esp_transport_handle_t t, int timeout_ms) {
+	tls_ctx_t *ctx = esp_transport_get_context_data(t);
+	if (!ctx->open)
+		return -1;
+	return tls_poll(ctx->net.fd, timeout_ms, true);
+}
+
+static int tls_read(esp_transport_handle_t t, char *buffer, int len,
+					int timeout_ms) {
+	tls_ctx_t *ctx = esp_transport_get_context_data(t);
+	if (!ctx->open)
+		return -1;
+
+	if (mbedtls_ssl_get_bytes_avail(&ctx->ssl) == 0) {
+		int poll = tls_poll(ctx->net.fd, timeout_ms, false);
+		if (poll <= 0)
+			return poll < 0 ? -1 : ERR_TCP_TRANSPORT_CONNECTION_TIMEOUT;
+	}
+
+	int ret = mbedtls_ssl_read(&ctx->ssl, (unsigned char *)buffer, len);
+	if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE)
+		return ERR_TCP_TRANSPORT_CONNECTION_TIMEOUT;
+	if (ret == 0 || ret == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY)
+		return ERR_TCP_TRANSPORT_CONNECTION_CLOSED_BY_FIN;
+	return ret < 0 ? -1 : ret;
+}
+
+static int tls_write(esp_transport_handle_t t, const char *buffer, int len,
+					 int timeout_ms) {
+	tls_ctx_t *ctx = esp_transport_get_context_data(t);
+	if (!ctx->open)
+		return -1;
+
+	int poll = tls_poll(ctx->net.fd, timeout_ms, true);
+	if (poll <= 0)
+		return poll < 0 ? -1 : ERR_TCP_TRANSPORT_CONNECTION_TIMEOUT;
+
+	int ret = mbedtls_ssl_write(&ctx->ssl, (const unsigned char *)buffer, len);
+	if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE)
+		return ERR_TCP_TRANSPORT_CONNECTION_TIMEOUT;
+	return ret < 0 ? -1 : ret;
+}
+
+static int tls_close(esp_transport_handle_t t) {
+	tls_ctx_t *ctx = esp_transport_get_context_data(t);
+	if (ctx->open) {
+		mbedtls_ssl_close_notify(&ctx->ssl);
+		tls_free(ctx);
+	}
+	return 0;
+}
+
+static int tls_destroy(esp_transport_handle_t t) {
+	tls_close(t);
+	free(esp_transport_get_context_data(t));
+	return 0;
+}
+
+esp_transport_handle_t osj_ws_tls_transport_init(void) {
+	esp_transport_handle_t t = esp_transport_init();
+	tls_ctx_t *ctx = calloc(1, sizeof(tls_ctx_t));
+	if (!t || !ctx) {
+		free(ctx);
+		if (t)
+			esp_transport_destroy(t);
+		return NULL;
+	}
+	esp_transport_set_context_data(t, ctx);
+	esp_transport_set_default_port(t, 443);
+	esp_transport_set_func(t, tls_connect, tls_read, tls_write, tls_close,
+						   tls_poll_read, tls_poll_write, tls_destroy);
+	return t;
+}
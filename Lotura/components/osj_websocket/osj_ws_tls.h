@@ -0,0 +1,16 @@
+#ifndef OSJ_WS_TLS_H
+#define OSJ_WS_TLS_H
+
+#include "esp_transport.h"
+
+/**
+ * @brief TLS 세션 재개를 지원하는 SSL 전송 계층을 생성한다.
+ * @details esp-tls의 TCP 연결 위에서 mbedtls로 직접 핸드셰이크하고, 끝나면
+ * 세션 티켓/ID를 RAM에 보관해 다음 재연결 때 제시한다.
+ * CONFIG_OSJ_WS_TLS_SESSION_RTC가 켜져 있으면 소프트 리셋 후에도 쓸 수 있도록
+ * RTC 메모리에 직렬화해 둔다.
+ * @return esp_transport_ws_init()의 부모로 쓸 전송 핸들, 실패 시 NULL
+ */
+esp_transport_handle_t osj_ws_tls_transport_init(void);
+
+#endif
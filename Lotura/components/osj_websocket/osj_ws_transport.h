@@ -0,0 +1,66 @@
+#ifndef OSJ_WS_TRANSPORT_H
+#define OSJ_WS_TRANSPORT_H
+
+#include "esp_err.h"
+#include "osj_ws_identity.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief 퍼블리셔 아래에서 실제 연결을 담당하는 전송 백엔드.
+ * @details 세션은 백엔드가 만든 불투명 핸들이다. connect/disconnect/publish/
+ * subscribe는 퍼블리셔 태스크에서만 호출된다. 백엔드는 자기 태스크에서
+ * osj_ws_transport_on_*() 콜백으로 이벤트를 올린다.
+ */
+typedef struct {
+	const char *name;
+
+	/**
+	 * @brief 식별 정보로 세션을 만들고 연결을 시작한다 (블로킹하지 않음).
+	 * @return 세션 핸들, 실패 시 NULL
+	 */
+	void *(*connect)(const osj_ws_identity_t *id);
+
+	/**
+	 * @brief 세션을 끊고 해제한다.
+	 */
+	void (*disconnect)(void *session);
+
+	/**
+	 * @brief 상향 프레임 하나를 보낸다.
+	 * @return 0 이상이면 성공, 음수면 실패 (나중에 다시 보냄)
+	 */
+	int (*publish)(void *session, const char *frame, size_t len,
+				   int timeout_ms);
+
+	/**
+	 * @brief 하향 채널을 구독한다. 연결될 때마다 호출된다.
+	 * @param channel 논리 채널 이름 (예: "cmd")
+	 */
+	esp_err_t (*subscribe)(void *session, const char *channel);
+
+	/**
+	 * @brief 세션이 지금 연결되어 있는지 반환한다.
+	 */
+	bool (*is_connected)(void *session);
+} osj_ws_transport_t;
+
+extern const osj_ws_transport_t osj_ws_transport_websocket;
+extern const osj_ws_transport_t osj_ws_transport_mqtt;
+
+/**
+ * @brief 백엔드가 연결을 마쳤을 때 호출한다.
+ */
+void osj_ws_transport_on_connected(void *session);
+
+/**
+ * @brief 백엔드 연결이 끊겼을 때 호출한다.
+ */
+void osj_ws_transport_on_disconnected(void *session);
+
+/**
+ * @brief 하향 메시지 하나(완전한 JSON 텍스트)를 받았을 때 호출한다.
+ */
+void osj_ws_transport_on_message(void *session, const char *data, size_t len);
+
+#endif
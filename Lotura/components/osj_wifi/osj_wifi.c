@@ -6,6 +6,7 @@
 #include "freertos/event_groups.h"
 #include "freertos/task.h"
 #include "freertos/timers.h"
+#include "osj_boot.h"
 #include "osj_nvs.h"
 #include <string.h>
 #include "esp_sntp.h"
@@ -74,6 +75,7 @@ static void event_handler(void *arg, esp_event_base_t event_base,
 		ESP_LOGI(TAG, "got ip:" IPSTR, IP2STR(&event->ip_info.ip));
 		s_retry_num = 0;
 		s_is_connected = true;
+		osj_boot_mark(OSJ_BOOT_IP);
 
 		static bool sntp_inited = false;
 		if (!sntp_inited) {
@@ -8,52 +8,64 @@
 #include <stdio.h>
 
 #include "laundry_core.h"
+#include "osj_boot.h"
 #include "osj_gpio.h"
 #include "osj_http.h"
 #include "osj_nvs.h"
+#include "osj_remote.h"
 #include "osj_sensor.h"
+#include "osj_time.h"
 #include "osj_websocket.h"
 #include "osj_wifi.h"
 
-#include "esp_sntp.h"
-#include <time.h>
-
 static const char *TAG = "MAIN_APP";
 
-void app_main(void) {
-	ESP_LOGI(TAG, "[Step 1] Initializing System...");
-	osj_nvs_init();
+static void netif_init(void) {
 	ESP_ERROR_CHECK(esp_netif_init());
 	ESP_ERROR_CHECK(esp_event_loop_create_default());
+}
 
-	// OTA Rollback check (Mark as valid after booting)
-	esp_ota_mark_app_valid_cancel_rollback();
+static void core_start(void) {
+	xTaskCreate(laundry_core_task, "laundry_core", 6144, NULL, 5, NULL);
+}
 
-	ESP_LOGI(TAG, "[Step 2] Initializing Peripherals...");
-	osj_gpio_init();
-	osj_sensor_init();
+#define DEP(stage) OSJ_BOOT_BIT(OSJ_BOOT_##stage)
 
-	ESP_LOGI(TAG, "[Step 3] Starting Network Services...");
-	osj_wifi_init();
-	osj_http_start_server();
+// Each step starts as soon as its dependencies are done. The core task only
+// waits for the local peripherals, and Wi-Fi comes up next to it. Wi-Fi
+// waits for the publisher so the TimeFix hook is in place before SNTP runs,
+// and HTTP waits for Wi-Fi because the status page reads the MAC/IP.
+static const osj_boot_step_t boot_steps[] = {
+	{OSJ_BOOT_NVS, 0, osj_nvs_init, 0},
+	{OSJ_BOOT_NETIF, 0, netif_init, 0},
+	{OSJ_BOOT_GPIO, 0, osj_gpio_init, 0},
+	{OSJ_BOOT_SENSOR, DEP(GPIO), osj_sensor_init, 0},
+	{OSJ_BOOT_TIME, 0, osj_time_init, 0},
+	{OSJ_BOOT_PUBLISHER, DEP(NVS) | DEP(TIME), osj_websocket_init, 0},
+	{OSJ_BOOT_CORE,
+	 DEP(NVS) | DEP(GPIO) | DEP(SENSOR) | DEP(TIME) | DEP(PUBLISHER),
+	 core_start, 0},
+	{OSJ_BOOT_WIFI, DEP(NVS) | DEP(NETIF) | DEP(PUBLISHER), osj_wifi_init, 0},
+	{OSJ_BOOT_HTTP, DEP(WIFI), osj_http_start_server, 0},
+	{OSJ_BOOT_REMOTE, DEP(PUBLISHER), osj_remote_init, 0},
+	{OSJ_BOOT_LINK, DEP(WIFI) | DEP(REMOTE), osj_websocket_start, 0},
+};
 
-	int retry = 0;
-	const int retry_count = 15;
-	ESP_LOGI(TAG, "Waiting for system time to be synchronized...");
-	while (sntp_get_sync_status() == SNTP_SYNC_STATUS_RESET && ++retry < retry_count) {
-		ESP_LOGI(TAG, "Waiting... (%d/%d)", retry, retry_count);
-		vTaskDelay(2000 / portTICK_PERIOD_MS);
-	}
+void app_main(void) {
+	ESP_LOGI(TAG, "Booting...");
+	osj_boot_init();
 
-	if (retry == retry_count) {
-		ESP_LOGE(TAG, "Failed to synchronize time. WSS connection might fail.");
-	} else {
-		ESP_LOGI(TAG, "Time synchronized successfully!");
-	}
+	// OTA Rollback check (Mark as valid after booting)
+	esp_ota_mark_app_valid_cancel_rollback();
 
-	osj_websocket_start();
+	osj_boot_run(boot_steps, sizeof(boot_steps) / sizeof(boot_steps[0]));
 
-	ESP_LOGI(TAG, "[Step 4] Launching Core Logic Task...");
-	xTaskCreate(laundry_core_task, "laundry_core", 6144, NULL, 5, NULL);
-	ESP_LOGI(TAG, "System Boot Complete. Entering Idle Loop.");
-}
\ No newline at end of file
+	// On timeout the finished stages show where boot stalled.
+	bool done = osj_boot_wait(DEP(DETECT) | DEP(CONNECTED), 60000);
+	char times[256];
+	osj_boot_format(times, sizeof(times));
+	if (done)
+		ESP_LOGI(TAG, "System Boot Complete: %s", times);
+	else
+		ESP_LOGW(TAG, "Boot incomplete 60 s after start: %s", times);
+}
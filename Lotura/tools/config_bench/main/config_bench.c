@@ -0,0 +1,146 @@
+#include "esp_cpu.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "osj_config.h"
+#include "osj_snapshot.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "CFG_BENCH";
+
+typedef enum {
+	MODE_MUTEX,		 // take, copy, give: the old osj_config_lock() path
+	MODE_SNAPSHOT,	 // acquire, copy, release
+	MODE_GENERATION, // copy only when the version moved, as laundry_core does
+} bench_mode_t;
+
+static const char *const mode_names[] = {"mutex", "snapshot", "generation"};
+
+static SemaphoreHandle_t mutex;
+static SystemConfig locked_cfg;
+
+static SystemConfig slots[2];
+static osj_snapshot_t snap;
+
+static volatile bench_mode_t mode;
+static volatile bool writer_run = false;
+static volatile bool writer_done = false;
+static uint32_t writes = 0;
+static int64_t write_max_us = 0;
+
+// Every write sets these three fields from one counter, so a reader that
+// sees them disagree has copied a half-written record.
+static void fill(SystemConfig *c, uint32_t n) {
+	c->ch1CurrW = (float)n;
+	c->ch2CurrW = (float)n;
+	snprintf(c->roomNo, sizeof(c->roomNo), "%lu", n);
+}
+
+static bool torn(const SystemConfig *c) {
+	return c->ch1CurrW != c->ch2CurrW ||
+		   strtoul(c->roomNo, NULL, 10) != (uint32_t)c->ch1CurrW;
+}
+
+static void writer_task(void *arg) {
+	SystemConfig next = locked_cfg;
+	while (writer_run) {
+		fill(&next, ++writes);
+		int64_t t0 = esp_timer_get_time();
+		if (mode == MODE_MUTEX) {
+			xSemaphoreTake(mutex, portMAX_DELAY);
+			locked_cfg = next;
+			xSemaphoreGive(mutex);
+		} else {
+			osj_snapshot_publish(&snap, &next);
+		}
+		int64_t took = esp_timer_get_time() - t0;
+		if (took > write_max_us)
+			write_max_us = took;
+#if CONFIG_OSJ_CFG_BENCH_WRITE_PERIOD_MS > 0
+		vTaskDelay(pdMS_TO_TICKS(CONFIG_OSJ_CFG_BENCH_WRITE_PERIOD_MS));
+#else
+		// Let the idle task on this core run now and then.
+		if ((writes & 0x3ff) == 0)
+			vTaskDelay(1);
+#endif
+	}
+	writer_done = true;
+	vTaskDelete(NULL);
+}
+
+static void run(bench_mode_t m) {
+	SystemConfig local;
+	uint32_t seen_gen = 0;
+	uint64_t sum = 0;
+	uint32_t worst = 0, bad = 0, copies = 0;
+
+	mode = m;
+	writes = 0;
+	write_max_us = 0;
+	writer_done = false;
+	writer_run = true;
+	xTaskCreatePinnedToCore(writer_task, "cfg_writer", 4096, NULL, 5, NULL,
+							1);
+
+	for (uint32_t i = 0; i < CONFIG_OSJ_CFG_BENCH_READS; i++) {
+		uint32_t c0 = esp_cpu_get_cycle_count();
+		if (m == MODE_MUTEX) {
+			xSemaphoreTake(mutex, portMAX_DELAY);
+			local = locked_cfg;
+			xSemaphoreGive(mutex);
+			copies++;
+		} else if (m == MODE_SNAPSHOT ||
+				   osj_snapshot_version(&snap) != seen_gen) {
+			seen_gen = osj_snapshot_version(&snap);
+			const SystemConfig *cur = osj_snapshot_acquire(&snap);
+			local = *cur;
+			osj_snapshot_release(&snap, cur);
+			copies++;
+		}
+		uint32_t d = esp_cpu_get_cycle_count() - c0;
+		sum += d;
+		if (d > worst)
+			worst = d;
+		if (torn(&local))
+			bad++;
+	}
+
+	writer_run = false;
+	while (!writer_done)
+		vTaskDelay(1);
+
+	printf("mode=%s reads=%d copies=%lu avg_cycles=%.1f max_cycles=%lu "
+		   "torn=%lu writes=%lu write_max_us=%lld\n",
+		   mode_names[m], CONFIG_OSJ_CFG_BENCH_READS, copies,
+		   (double)sum / CONFIG_OSJ_CFG_BENCH_READS, worst, bad, writes,
+		   write_max_us);
+}
+
+static void bench_task(void *arg) {
+	run(MODE_MUTEX);
+	run(MODE_SNAPSHOT);
+	run(MODE_GENERATION);
+	fflush(stdout);
+	vTaskDelete(NULL);
+}
+
+void app_main(void) {
+	SystemConfig initial;
+	memset(&initial, 0, sizeof(initial));
+	fill(&initial, 0);
+
+	mutex = xSemaphoreCreateMutex();
+	locked_cfg = initial;
+	osj_snapshot_init(&snap, &slots[0], &slots[1], sizeof(SystemConfig),
+					  &initial);
+
+	ESP_LOGI(TAG, "SystemConfig is %u bytes", (unsigned)sizeof(SystemConfig));
+	// Same priority as laundry_core; the writer gets the other core.
+	xTaskCreatePinnedToCore(bench_task, "cfg_reader", 4096, NULL, 5, NULL, 0);
+}
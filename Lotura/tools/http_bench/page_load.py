@@ -0,0 +1,101 @@
+# SPDX-License-Identifier: Unlicense OR CC0-1.0
+"""Times status page loads from the device's HTTP server.
+
+Fetches GET / over a fresh connection N times and reports time to first
+byte, time to last byte, the number of HTTP chunks in the body and the
+number of recv() calls it took to read the response. recv() calls only
+approximate the TCP segments the device sent; use a packet capture for exact
+segment counts.
+
+With --revalidate, every request after the first sends the ETag it got back
+in If-None-Match, the way a browser reloads a cached page.
+
+    python3 page_load.py 192.168.4.1 [-n 20] [--path /] [--revalidate]
+"""
+import argparse
+import socket
+import statistics
+import time
+
+
+def fetch(host, port, path, etag=None):
+    s = socket.create_connection((host, port), timeout=10)
+    s.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+    extra = 'If-None-Match: {}\r\n'.format(etag) if etag else ''
+    t0 = time.monotonic()
+    s.sendall('GET {} HTTP/1.1\r\nHost: {}\r\nAccept-Encoding: gzip\r\n{}'
+              'Connection: close\r\n\r\n'.format(path, host, extra).encode())
+    data = bytearray()
+    recvs = 0
+    first = None
+    while True:
+        buf = s.recv(65536)
+        if not buf:
+            break
+        if first is None:
+            first = time.monotonic()
+        recvs += 1
+        data += buf
+    last = time.monotonic()
+    s.close()
+    return ((first or last) - t0, last - t0, recvs, bytes(data))
+
+
+def header(resp, name):
+    head = resp.partition(b'\r\n\r\n')[0].decode('latin-1')
+    for line in head.split('\r\n')[1:]:
+        key, _, value = line.partition(':')
+        if key.strip().lower() == name.lower():
+            return value.strip()
+    return None
+
+
+def count_chunks(resp):
+    head, _, body = resp.partition(b'\r\n\r\n')
+    if b'chunked' not in head.lower():
+        return 1
+    chunks = 0
+    while body:
+        line, _, body = body.partition(b'\r\n')
+        size = int(line.split(b';')[0], 16)
+        if size == 0:
+            break
+        chunks += 1
+        body = body[size + 2:]
+    return chunks
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('host')
+    parser.add_argument('--port', type=int, default=80)
+    parser.add_argument('--path', default='/')
+    parser.add_argument('-n', type=int, default=20)
+    parser.add_argument('--revalidate', action='store_true')
+    args = parser.parse_args()
+
+    ttfb, total, recvs, chunks, sizes = [], [], [], [], []
+    etag = None
+    status = ''
+    for _ in range(args.n):
+        a, b, r, resp = fetch(args.host, args.port, args.path, etag)
+        ttfb.append(a * 1000)
+        total.append(b * 1000)
+        recvs.append(r)
+        chunks.append(count_chunks(resp))
+        sizes.append(len(resp))
+        status = resp.split(b'\r\n', 1)[0].decode('latin-1')
+        if args.revalidate:
+            etag = header(resp, 'ETag')
+
+    print('ttfb_ms p50={:.1f} max={:.1f}'.format(statistics.median(ttfb),
+                                                max(ttfb)))
+    print('load_ms p50={:.1f} max={:.1f}'.format(statistics.median(total),
+                                                max(total)))
+    print('chunks={} recv_calls p50={}'.format(chunks[-1],
+                                               statistics.median(recvs)))
+    print('last="{}" bytes_on_wire={}'.format(status, sizes[-1]))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,13 @@
+#include "osj_wifi.h"
+#include <string.h>
+
+// The host has no Wi-Fi driver; the benchmark only needs the link up.
+void osj_wifi_init(void) {}
+
+bool osj_wifi_is_connected(void) { return true; }
+
+void osj_wifi_get_mac(char *mac_str) { strcpy(mac_str, "000000000000"); }
+
+void osj_wifi_get_ip(char *ip_str) { strcpy(ip_str, "127.0.0.1"); }
+
+int8_t osj_wifi_get_rssi(void) { return -50; }
@@ -0,0 +1,227 @@
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "osj_nvs.h"
+#include "osj_websocket.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#if CONFIG_IDF_TARGET_LINUX
+#include <malloc.h>
+#else
+#include "esp_system.h"
+#endif
+
+static const char *TAG = "WS_BENCH";
+
+#define MAX_SAMPLES                                                            \
+	(CONFIG_OSJ_BENCH_BURSTS * CONFIG_OSJ_BENCH_BURST_FRAMES +                 \
+	 CONFIG_OSJ_BENCH_RECONNECTS + 16)
+
+// A burst counts as finished once no ACK has arrived for this long.
+#define SETTLE_US (2000 * 1000LL)
+#define CONNECT_TIMEOUT_US (30 * 1000000LL)
+
+// Written by the publisher task through the ACK observer, read here.
+static int64_t *samples = NULL;
+static volatile size_t sample_count = 0;
+static volatile int64_t last_ack_us = 0;
+
+#if CONFIG_IDF_TARGET_LINUX
+static size_t heap_peak = 0;
+#else
+static size_t heap_min_free = SIZE_MAX;
+#endif
+
+static void on_ack(bool urgent, int64_t latency_us) {
+	if (sample_count < MAX_SAMPLES)
+		samples[sample_count++] = latency_us;
+	last_ack_us = esp_timer_get_time();
+}
+
+static void sample_heap(void) {
+#if CONFIG_IDF_TARGET_LINUX
+	struct mallinfo2 mi = mallinfo2();
+	if (mi.uordblks > heap_peak)
+		heap_peak = mi.uordblks;
+#else
+	size_t min_free = esp_get_minimum_free_heap_size();
+	if (min_free < heap_min_free)
+		heap_min_free = min_free;
+#endif
+}
+
+static bool wait_for_state(osj_ws_state_t state, int64_t timeout_us) {
+	int64_t deadline = esp_timer_get_time() + timeout_us;
+	while (osj_websocket_get_state() != state) {
+		if (esp_timer_get_time() > deadline)
+			return false;
+		vTaskDelay(1);
+	}
+	return true;
+}
+
+// Waits until every frame sent so far was ACKed or the ACK stream stalls.
+static void wait_settled(size_t expected) {
+	int64_t idle_since = esp_timer_get_time();
+	size_t seen = sample_count;
+	while (sample_count < expected) {
+		sample_heap();
+		vTaskDelay(pdMS_TO_TICKS(10));
+		if (sample_count != seen) {
+			seen = sample_count;
+			idle_since = esp_timer_get_time();
+		} else if (esp_timer_get_time() - idle_since > SETTLE_US) {
+			break;
+		}
+	}
+}
+
+static int cmp_i64(const void *a, const void *b) {
+	int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+	return (x > y) - (x < y);
+}
+
+static double percentile_ms(const int64_t *sorted, size_t n, double p) {
+	if (n == 0)
+		return 0;
+	size_t i = (size_t)(p * (n - 1) + 0.5);
+	return sorted[i] / 1000.0;
+}
+
+static void run_bursts(size_t *sent_out, int64_t *busy_us_out) {
+	char log_json[48];
+	size_t sent = 0;
+	int64_t busy_us = 0;
+
+	for (int b = 0; b < CONFIG_OSJ_BENCH_BURSTS; b++) {
+		size_t acked_before = sample_count;
+		int64_t t0 = esp_timer_get_time();
+		for (int i = 0; i < CONFIG_OSJ_BENCH_BURST_FRAMES; i++) {
+			if (i % 100 < CONFIG_OSJ_BENCH_LOG_PERCENT) {
+				snprintf(log_json, sizeof(log_json),
+						 "{\"bench\":%d,\"i\":%d}", b, i);
+				osj_websocket_send_log(1, log_json);
+			} else {
+				osj_websocket_send_status(1, i & 1, "WASH");
+			}
+		}
+		sent += CONFIG_OSJ_BENCH_BURST_FRAMES;
+		wait_settled(acked_before + CONFIG_OSJ_BENCH_BURST_FRAMES);
+		if (sample_count > acked_before)
+			busy_us += last_ack_us - t0;
+
+		ESP_LOGI(TAG, "Burst %d: %u/%d acked", b + 1,
+				 (unsigned)(sample_count - acked_before),
+				 CONFIG_OSJ_BENCH_BURST_FRAMES);
+		vTaskDelay(pdMS_TO_TICKS(CONFIG_OSJ_BENCH_BURST_GAP_MS));
+	}
+	*sent_out = sent;
+	*busy_us_out = busy_us;
+}
+
+// The stand-in server closes the socket when it sees a "drop" log. Recovery
+// is measured from the moment the link goes down until the first frame
+// queued after that is ACKed, so it includes backoff, TCP/TLS and upgrade.
+static void run_reconnects(void) {
+	int64_t total_us = 0, worst_us = 0;
+	int rounds = 0;
+
+	for (int r = 0; r < CONFIG_OSJ_BENCH_RECONNECTS; r++) {
+		if (!wait_for_state(OSJ_WS_STATE_CONNECTED, CONNECT_TIMEOUT_US))
+			break;
+		osj_websocket_send_log(1, "{\"bench\":\"drop\"}");
+		size_t acked = sample_count;
+		wait_settled(acked + 1);
+
+		int64_t deadline = esp_timer_get_time() + CONNECT_TIMEOUT_US;
+		while (osj_websocket_get_state() == OSJ_WS_STATE_CONNECTED &&
+			   esp_timer_get_time() < deadline)
+			vTaskDelay(1);
+		int64_t down_us = esp_timer_get_time();
+
+		acked = sample_count;
+		osj_websocket_send_status(1, 1, "WASH");
+		while (sample_count == acked && esp_timer_get_time() < deadline)
+			vTaskDelay(1);
+		if (sample_count == acked) {
+			ESP_LOGW(TAG, "Reconnect %d: no recovery within timeout", r + 1);
+			continue;
+		}
+
+		int64_t took = last_ack_us - down_us;
+		ESP_LOGI(TAG, "Reconnect %d: recovered in %.1f ms", r + 1,
+				 took / 1000.0);
+		total_us += took;
+		if (took > worst_us)
+			worst_us = took;
+		rounds++;
+	}
+
+	if (rounds > 0) {
+		printf("reconnect_recovery_ms avg=%.1f max=%.1f rounds=%d\n",
+			   total_us / 1000.0 / rounds, worst_us / 1000.0, rounds);
+	}
+}
+
+void app_main(void) {
+	samples = calloc(MAX_SAMPLES, sizeof(int64_t));
+	if (!samples) {
+		ESP_LOGE(TAG, "No memory for %d samples", MAX_SAMPLES);
+		return;
+	}
+
+	osj_nvs_init();
+	osj_nvs_set_str("ch1DeviceNo", "101");
+	osj_nvs_set_str("ch2DeviceNo", "102");
+	osj_nvs_set_str("authId", "bench");
+	osj_nvs_set_str("authPasswd", "bench");
+
+	osj_websocket_set_ack_observer(on_ack);
+	osj_websocket_start();
+	if (!wait_for_state(OSJ_WS_STATE_CONNECTED, CONNECT_TIMEOUT_US)) {
+		ESP_LOGE(TAG, "Could not connect to %s", CONFIG_OSJ_WS_URI);
+		return;
+	}
+	sample_heap();
+
+	size_t sent = 0;
+	int64_t busy_us = 0;
+	run_bursts(&sent, &busy_us);
+
+	size_t n = sample_count;
+	int64_t *sorted = malloc(n * sizeof(int64_t));
+	if (sorted) {
+		for (size_t i = 0; i < n; i++)
+			sorted[i] = samples[i];
+		qsort(sorted, n, sizeof(int64_t), cmp_i64);
+	}
+
+	printf("frames sent=%u acked=%u\n", (unsigned)sent, (unsigned)n);
+	printf("frames_per_s %.1f\n", busy_us > 0 ? n * 1e6 / busy_us : 0.0);
+	if (sorted) {
+		printf("latency_ms p50=%.2f p99=%.2f max=%.2f\n",
+			   percentile_ms(sorted, n, 0.50), percentile_ms(sorted, n, 0.99),
+			   n ? sorted[n - 1] / 1000.0 : 0.0);
+		free(sorted);
+	}
+#if CONFIG_IDF_TARGET_LINUX
+	printf("heap_peak_bytes %u\n", (unsigned)heap_peak);
+#else
+	printf("heap_min_free_bytes %u\n", (unsigned)heap_min_free);
+#endif
+
+	run_reconnects();
+
+	char *stats = osj_websocket_get_stats_json();
+	if (stats) {
+		printf("stats %s\n", stats);
+		free(stats);
+	}
+	fflush(stdout);
+#if CONFIG_IDF_TARGET_LINUX
+	exit(0);
+#endif
+}
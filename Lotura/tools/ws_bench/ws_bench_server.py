@@ -0,0 +1,99 @@
+# SPDX-License-Identifier: Unlicense OR CC0-1.0
+"""Stand-in backend for tools/ws_bench.
+
+Reuses the test server shipped with esp_websocket_client and swaps its echo
+handler for one that speaks the Lotura frame protocol: every frame carrying
+"seq" is acknowledged with {"title":"Ack","seq":N}, and a Log frame with
+{"bench":"drop"} makes the server close the connection so the device has to
+reconnect.
+"""
+import argparse
+import json
+import os
+import ssl
+import sys
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+EXAMPLE_DIR = os.path.join(HERE, '../../managed_components/espressif__esp_websocket_client/examples/target')
+CERT_DIR = os.path.join(EXAMPLE_DIR, 'main', 'certs', 'server')
+sys.path.insert(0, EXAMPLE_DIR)
+
+from websocket_server import (SimpleSSLWebSocketServer,  # noqa: E402
+                              SimpleWebSocketServer, WebSocket)
+
+ACK_EVERY = 1
+ACK_DELAY_S = 0.0
+
+
+class LoturaBenchHandler(WebSocket):
+    """Acknowledges frames the way the production server does."""
+
+    def handleConnected(self):
+        self.pending = 0
+        self.frames = 0
+        self.started = time.monotonic()
+        print('Connection from: {}'.format(self.address))
+
+    def handleMessage(self):
+        try:
+            frame = json.loads(self.data)
+        except (TypeError, ValueError):
+            return
+        seq = frame.get('seq')
+        if seq is None:
+            return
+
+        self.frames += 1
+        self.pending += 1
+        drop = frame.get('title') == 'Log' and isinstance(frame.get('log'), dict) \
+            and frame['log'].get('bench') == 'drop'
+
+        # ACKs are cumulative, so batching them only delays the window.
+        if self.pending >= ACK_EVERY or drop:
+            if ACK_DELAY_S:
+                time.sleep(ACK_DELAY_S)
+            self.sendMessage(json.dumps({'title': 'Ack', 'seq': seq}))
+            self.pending = 0
+        if drop:
+            print('Dropping {} on request'.format(self.address))
+            self.close()
+
+    def handleClose(self):
+        elapsed = time.monotonic() - self.started
+        rate = self.frames / elapsed if elapsed > 0 else 0
+        print('{} closed after {} frames ({:.1f} frames/s)'.format(self.address, self.frames, rate))
+
+
+def main():
+    global ACK_EVERY, ACK_DELAY_S
+
+    parser = argparse.ArgumentParser(description='Lotura websocket benchmark server')
+    parser.add_argument('--port', type=int, default=8080)
+    parser.add_argument('--tls', action='store_true', help='Serve wss:// with the example certificates')
+    parser.add_argument('--ack-every', type=int, default=1, help='Acknowledge every Nth frame (cumulative)')
+    parser.add_argument('--ack-delay-ms', type=float, default=0, help='Artificial server-side ACK delay')
+    args = parser.parse_args()
+
+    ACK_EVERY = max(1, args.ack_every)
+    ACK_DELAY_S = args.ack_delay_ms / 1000.0
+
+    # The example's own runner loads its certificates relative to the
+    # working directory, so the server is built here with paths taken from
+    # this file instead.
+    if args.tls:
+        context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+        context.load_cert_chain(certfile=os.path.join(CERT_DIR, 'server_cert.pem'),
+                                keyfile=os.path.join(CERT_DIR, 'server_key.pem'))
+        server = SimpleSSLWebSocketServer('', args.port, LoturaBenchHandler, ssl_context=context)
+    else:
+        server = SimpleWebSocketServer('', args.port, LoturaBenchHandler)
+    print('Serving {}://0.0.0.0:{}'.format('wss' if args.tls else 'ws', args.port))
+    try:
+        server.serveforever()
+    except KeyboardInterrupt:
+        server.close()
+
+
+if __name__ == '__main__':
+    main()